@@ -0,0 +1,159 @@
+// 各人脸检测后端在本地图像集上的延迟、吞吐量与召回率对比
+// 用法: face_detectors <图像目录> [标注文件, "-" 表示无标注] [最长边=640]
+// 标注文件每行一个人脸: "文件名 x y w h"（原图像素坐标）；不提供时假定每张图像至少有一张人脸，
+// 召回率按"检测到人脸的图像数 / 图像总数"计算。模型文件缺失的后端会被跳过。
+#include "FaceDetector.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <opencv2/imgcodecs.hpp>
+
+namespace {
+
+struct Sample
+{
+    std::string name;
+    cv::Mat image;
+    std::vector<cv::Rect> truth;
+};
+
+double iou(const cv::Rect &a, const cv::Rect &b)
+{
+    double overlap = (a & b).area();
+    double total = a.area() + b.area() - overlap;
+    return total > 0 ? overlap / total : 0.0;
+}
+
+double percentile(std::vector<double> values, double p)
+{
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    std::size_t index = std::min(values.size() - 1, static_cast<std::size_t>(p * values.size()));
+    return values[index];
+}
+
+std::map<std::string, std::vector<cv::Rect>> loadAnnotations(const std::string &path)
+{
+    std::map<std::string, std::vector<cv::Rect>> annotations;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string name;
+        cv::Rect box;
+        if (fields >> name >> box.x >> box.y >> box.width >> box.height) {
+            annotations[name].push_back(box);
+        }
+    }
+    return annotations;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        std::fprintf(stderr, "用法: %s <图像目录> [标注文件|-] [最长边=640]\n", argv[0]);
+        return 1;
+    }
+    const std::string imageDir = argv[1];
+    const bool annotated = argc > 2 && std::string(argv[2]) != "-";
+    const int maxSide = argc > 3 ? std::atoi(argv[3]) : 640;
+
+    std::map<std::string, std::vector<cv::Rect>> annotations;
+    if (annotated) {
+        annotations = loadAnnotations(argv[2]);
+    }
+
+    std::vector<Sample> samples;
+    for (const auto &entry : std::filesystem::directory_iterator(imageDir)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        cv::Mat image = cv::imread(entry.path().string(), cv::IMREAD_COLOR);
+        if (image.empty()) {
+            continue;
+        }
+        Sample sample{entry.path().filename().string(), image, {}};
+        if (annotated) {
+            auto it = annotations.find(sample.name);
+            if (it == annotations.end()) {
+                continue;
+            }
+            sample.truth = it->second;
+        }
+        samples.push_back(std::move(sample));
+    }
+    if (samples.empty()) {
+        std::fprintf(stderr, "目录 %s 中没有可用的图像\n", imageDir.c_str());
+        return 1;
+    }
+
+    std::size_t truthCount = 0;
+    for (const auto &sample : samples) {
+        truthCount += sample.truth.size();
+    }
+    std::printf("图像数 %zu, 标注人脸数 %zu, 检测最长边 %d\n\n", samples.size(), truthCount, maxSide);
+    std::printf("%-8s %10s %10s %10s %10s %10s\n", "后端", "p50(ms)", "p99(ms)", "图像/秒", "召回率", "检测框数");
+
+    for (const char *backend : {"hog", "mmod", "yunet"}) {
+        std::unique_ptr<FaceDetector> detector;
+        try {
+            detector = FaceDetector::create(backend);
+        } catch (const std::exception &e) {
+            std::printf("%-8s 跳过: %s\n", backend, e.what());
+            continue;
+        }
+
+        // 首次调用包含惰性分配，不计入统计
+        detector->detect(samples.front().image, maxSide, true);
+
+        std::vector<double> latencies;
+        latencies.reserve(samples.size());
+        std::size_t matched = 0;
+        std::size_t detectedCount = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const auto &sample : samples) {
+            auto begin = std::chrono::steady_clock::now();
+            std::vector<dlib::rectangle> faces = detector->detect(sample.image, maxSide, true);
+            latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+            detectedCount += faces.size();
+
+            if (!annotated) {
+                matched += faces.empty() ? 0 : 1;
+                continue;
+            }
+
+            // 每个标注框贪心匹配一个未使用、IoU >= 0.5 的检测框
+            std::vector<bool> used(faces.size(), false);
+            for (const auto &truth : sample.truth) {
+                for (std::size_t i = 0; i < faces.size(); ++i) {
+                    cv::Rect box(static_cast<int>(faces[i].left()), static_cast<int>(faces[i].top()),
+                                 static_cast<int>(faces[i].width()), static_cast<int>(faces[i].height()));
+                    if (!used[i] && iou(box, truth) >= 0.5) {
+                        used[i] = true;
+                        ++matched;
+                        break;
+                    }
+                }
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        double recall = static_cast<double>(matched) / (annotated ? std::max<std::size_t>(1, truthCount) : samples.size());
+        std::printf("%-8s %10.2f %10.2f %10.1f %10.3f %10zu\n", detector->name().c_str(),
+                    percentile(latencies, 0.50), percentile(latencies, 0.99),
+                    samples.size() / seconds, recall, detectedCount);
+    }
+    return 0;
+}
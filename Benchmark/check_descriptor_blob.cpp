@@ -0,0 +1,109 @@
+// 人脸特征 BLOB 编解码校验：原始格式往返、旧格式（QDataStream）解码、格式判别
+// 用法: check_descriptor_blob，全部通过时返回 0
+#include "DescriptorBlob.h"
+#include "check_support.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+
+using checks::check;
+
+std::vector<char> encodeRaw(const std::vector<float> &values)
+{
+    std::vector<char> blob(values.size() * sizeof(float));
+    DescriptorBlob::encode(values.data(), values.size(), blob.data());
+    return blob;
+}
+
+// 按 QDataStream（Qt_5_12，默认双精度）写出 QVector<float> 的格式构造旧格式数据
+std::vector<char> encodeLegacy(const std::vector<float> &values)
+{
+    std::vector<char> blob;
+    auto putBigEndian = [&blob](std::uint64_t bits, int bytes) {
+        for (int i = bytes - 1; i >= 0; --i) {
+            blob.push_back(static_cast<char>((bits >> (i * 8)) & 0xFF));
+        }
+    };
+    putBigEndian(values.size(), 4);
+    for (float value : values) {
+        double widened = value;
+        std::uint64_t bits;
+        std::memcpy(&bits, &widened, sizeof(bits));
+        putBigEndian(bits, 8);
+    }
+    return blob;
+}
+
+bool decodeEquals(const std::vector<char> &blob, const std::vector<float> &expected)
+{
+    if (DescriptorBlob::elementCount(blob.data(), blob.size()) != expected.size()) {
+        return false;
+    }
+    std::vector<float> decoded(expected.size());
+    return DescriptorBlob::decode(blob.data(), blob.size(), decoded.data())
+           && std::memcmp(decoded.data(), expected.data(), expected.size() * sizeof(float)) == 0;
+}
+
+} // namespace
+
+int main()
+{
+    const int dim = DescriptorBlob::DIMENSION;
+    std::mt19937 rng(7);
+    std::normal_distribution<float> dist(0.0f, 0.1f);
+
+    std::vector<float> single(dim);
+    for (float &value : single) {
+        value = dist(rng);
+    }
+    // 特殊值同样逐位保留
+    single[0] = -0.0f;
+    single[1] = std::numeric_limits<float>::denorm_min();
+    single[2] = std::numeric_limits<float>::max();
+
+    // 模板集：质心 + 5 个模板
+    std::vector<float> templateSet(dim * 6);
+    for (float &value : templateSet) {
+        value = dist(rng);
+    }
+
+    std::vector<char> raw = encodeRaw(single);
+    check(raw.size() == DescriptorBlob::RAW_DESCRIPTOR_BYTES, "单个特征编码为 512 字节");
+    check(DescriptorBlob::detect(raw.data(), raw.size()) == DescriptorBlob::Format::Raw, "单个特征判别为原始格式");
+    check(decodeEquals(raw, single), "单个特征原始格式往返逐位一致");
+
+    std::vector<char> rawSet = encodeRaw(templateSet);
+    check(DescriptorBlob::detect(rawSet.data(), rawSet.size()) == DescriptorBlob::Format::Raw, "模板集判别为原始格式");
+    check(decodeEquals(rawSet, templateSet), "模板集原始格式往返逐位一致");
+
+    std::vector<char> legacy = encodeLegacy(single);
+    check(legacy.size() == 4 + 8 * static_cast<std::size_t>(dim), "旧格式长度为 4 + 8n");
+    check(DescriptorBlob::detect(legacy.data(), legacy.size()) == DescriptorBlob::Format::Legacy, "单个特征判别为旧格式");
+    check(decodeEquals(legacy, single), "旧格式解码与原值逐位一致");
+
+    std::vector<char> legacySet = encodeLegacy(templateSet);
+    check(DescriptorBlob::detect(legacySet.data(), legacySet.size()) == DescriptorBlob::Format::Legacy, "模板集判别为旧格式");
+    check(decodeEquals(legacySet, templateSet), "模板集旧格式解码与原值逐位一致");
+
+    // 旧格式改写为原始格式后再读取，结果不变（后台迁移的路径）
+    std::vector<float> migrated(templateSet.size());
+    DescriptorBlob::decode(legacySet.data(), legacySet.size(), migrated.data());
+    check(decodeEquals(encodeRaw(migrated), templateSet), "旧格式迁移为原始格式无损");
+
+    // 长度模 512 余 4 但元素个数不吻合、或长度不属于任何格式的数据都拒绝
+    std::vector<char> badCount = legacy;
+    badCount[3] ^= 1;
+    check(DescriptorBlob::detect(badCount.data(), badCount.size()) == DescriptorBlob::Format::Unknown, "元素个数不符的旧格式被拒绝");
+    std::vector<char> odd(100, 0);
+    check(DescriptorBlob::detect(odd.data(), odd.size()) == DescriptorBlob::Format::Unknown, "长度不符的数据被拒绝");
+    check(DescriptorBlob::elementCount(odd.data(), odd.size()) == 0, "无法识别的数据元素个数为 0");
+    float sink = 0.0f;
+    check(!DescriptorBlob::decode(odd.data(), odd.size(), &sink), "无法识别的数据解码失败");
+
+    return checks::finish();
+}
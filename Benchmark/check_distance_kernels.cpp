@@ -0,0 +1,116 @@
+// 距离内核校验：各指令集实现与 double 标量参考实现一致（含非对齐指针与尾部维度），
+// squaredL2Exact 与顺序 double 累加逐位相同，selectTopK 与 partial_sort 结果一致
+// 用法: check_distance_kernels，全部通过时返回 0
+#include "DistanceKernels.h"
+#include "check_support.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+using checks::check;
+
+double referenceL2(const float *a, const float *b, int dim)
+{
+    double sum = 0.0;
+    for (int d = 0; d < dim; ++d) {
+        const double diff = static_cast<double>(a[d]) - static_cast<double>(b[d]);
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+double referenceInt8L2(const float *query, const std::int8_t *codes, const float *scales, int dim)
+{
+    double sum = 0.0;
+    for (int d = 0; d < dim; ++d) {
+        const double diff = static_cast<double>(query[d]) - static_cast<double>(scales[d]) * codes[d];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+// float 累加的误差随维度增长，按参考值的相对误差比较
+bool close(double value, double reference)
+{
+    return std::fabs(value - reference) <= 1e-5 * std::max(1.0, reference);
+}
+
+} // namespace
+
+int main()
+{
+    std::printf("指令集: %s\n", DistanceKernels::isaName());
+
+    std::mt19937 rng(5);
+    std::normal_distribution<float> dist(0.0f, 0.2f);
+    std::uniform_int_distribution<int> codeDist(-127, 127);
+
+    const int dims[] = {1, 3, 7, 8, 15, 16, 17, 31, 33, 64, 100, 127, 128, 129, 130};
+    const std::size_t rowCount = 37;
+
+    bool singleOk = true;
+    bool batchOk = true;
+    bool int8Ok = true;
+    bool exactOk = true;
+    for (int dim : dims) {
+        // 多分配一个元素并从 +1 处开始，让指针不按 SIMD 宽度对齐
+        std::vector<float> queryStorage(dim + 1);
+        std::vector<float> rowStorage(rowCount * dim + 1);
+        std::vector<std::int8_t> codeStorage(rowCount * dim + 1);
+        std::vector<float> scales(dim);
+        for (float &value : queryStorage) value = dist(rng);
+        for (float &value : rowStorage) value = dist(rng);
+        for (std::int8_t &code : codeStorage) code = static_cast<std::int8_t>(codeDist(rng));
+        for (float &scale : scales) scale = std::fabs(dist(rng)) / 127.0f + 1e-4f;
+
+        const float *query = queryStorage.data() + 1;
+        const float *rows = rowStorage.data() + 1;
+        const std::int8_t *codes = codeStorage.data() + 1;
+
+        std::vector<float> batch(rowCount);
+        std::vector<float> int8Batch(rowCount);
+        DistanceKernels::squaredL2Batch(query, rows, rowCount, dim, batch.data());
+        DistanceKernels::squaredL2Int8Batch(query, codes, scales.data(), rowCount, dim, int8Batch.data());
+
+        for (std::size_t r = 0; r < rowCount; ++r) {
+            const float *row = rows + r * dim;
+            const double reference = referenceL2(query, row, dim);
+            singleOk = singleOk && close(DistanceKernels::squaredL2(query, row, dim), reference);
+            batchOk = batchOk && close(batch[r], reference);
+            int8Ok = int8Ok && close(int8Batch[r], referenceInt8L2(query, codes + r * dim, scales.data(), dim));
+            exactOk = exactOk && DistanceKernels::squaredL2Exact(query, row, dim) == reference;
+        }
+    }
+    check(singleOk, "squaredL2 与标量参考一致");
+    check(batchOk, "squaredL2Batch 与标量参考一致");
+    check(int8Ok, "squaredL2Int8Batch 与标量参考一致");
+    check(exactOk, "squaredL2Exact 与顺序 double 累加逐位相同");
+
+    std::vector<float> values(1000);
+    std::uniform_int_distribution<int> valueDist(0, 200);   // 取值范围小，包含大量相同值
+    for (float &value : values) value = static_cast<float>(valueDist(rng));
+
+    bool topKOk = true;
+    const int ks[] = {1, 5, 32, 999, 1000, 1500};
+    for (int k : ks) {
+        std::vector<std::pair<float, std::uint32_t>> result;
+        DistanceKernels::selectTopK(values.data(), values.size(), k, result);
+
+        std::vector<float> expected(values);
+        const std::size_t n = std::min<std::size_t>(k, expected.size());
+        std::partial_sort(expected.begin(), expected.begin() + n, expected.end());
+
+        topKOk = topKOk && result.size() == n;
+        for (std::size_t i = 0; topKOk && i < n; ++i) {
+            topKOk = result[i].first == expected[i] && values[result[i].second] == result[i].first;
+        }
+    }
+    check(topKOk, "selectTopK 与 partial_sort 选出的值一致");
+
+    return checks::finish();
+}
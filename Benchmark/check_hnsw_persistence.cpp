@@ -0,0 +1,118 @@
+// HNSW 索引持久化校验：保存后加载的索引检索结果不变，损坏的索引文件被拒绝且不影响已有索引
+// 用法: check_hnsw_persistence，全部通过时返回 0
+#include "HnswIndex.h"
+#include "check_support.h"
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using checks::check;
+
+const int kDim = 128;
+const int kM = 8;
+const std::size_t kCount = 2000;
+
+// 序列化格式中各字段的偏移（见 HnswIndex::save）
+const std::size_t kCountOffset = 4 + 4 + 4 + 8 + 8;
+const std::size_t kEntryPointOffset = kCountOffset + 8;
+const std::size_t kHeaderBytes = kEntryPointOffset + 4 + 4;
+
+template <typename T>
+void patch(std::string &bytes, std::size_t offset, T value)
+{
+    std::memcpy(&bytes[offset], &value, sizeof(T));
+}
+
+bool loads(const std::string &bytes)
+{
+    HnswIndex index(kDim, kM);
+    std::istringstream in(bytes);
+    return index.load(in);
+}
+
+} // namespace
+
+int main()
+{
+    std::mt19937 rng(11);
+    std::normal_distribution<float> dist(0.0f, 0.1f);
+    std::vector<float> vectors(kCount * kDim);
+    for (float &value : vectors) {
+        value = dist(rng);
+    }
+
+    HnswIndex original(kDim, kM, 100);
+    for (std::size_t i = 0; i < kCount; ++i) {
+        original.insert(vectors.data() + i * kDim);
+    }
+    for (std::uint32_t id = 0; id < 50; ++id) {
+        original.markDeleted(id * 7);
+    }
+
+    std::ostringstream out;
+    original.save(out);
+    const std::string saved = out.str();
+
+    HnswIndex restored(kDim, kM);
+    std::istringstream in(saved);
+    check(restored.load(in), "保存的索引可以加载");
+    check(restored.nodeCount() == original.nodeCount() && restored.deletedCount() == original.deletedCount(),
+          "节点数与删除标记数一致");
+
+    bool sameResults = true;
+    for (std::size_t q = 0; q < 100; ++q) {
+        const float *query = vectors.data() + (q * 13 % kCount) * kDim;
+        sameResults = sameResults && original.search(query, 10, 64) == restored.search(query, 10, 64);
+    }
+    check(sameResults, "加载后的检索结果与原索引逐项一致");
+
+    // 以下各种损坏都必须被拒绝
+    check(!loads(saved.substr(0, saved.size() - 3)), "截断的文件被拒绝");
+    check(!loads(saved.substr(0, kHeaderBytes + 100)), "只有文件头的文件被拒绝");
+
+    std::string badMagic = saved;
+    badMagic[0] ^= 0x5A;
+    check(!loads(badMagic), "魔数错误被拒绝");
+
+    std::string hugeCount = saved;
+    patch<std::uint64_t>(hugeCount, kCountOffset, std::uint64_t(1) << 40);
+    check(!loads(hugeCount), "超出文件长度的节点数被拒绝（不做超大分配）");
+
+    std::string smallM = saved;
+    patch<std::uint64_t>(smallM, 4 + 4 + 4, 1);
+    check(!loads(smallM), "maxM < 2 被拒绝");
+
+    std::string badEntry = saved;
+    patch<std::uint32_t>(badEntry, kEntryPointOffset, static_cast<std::uint32_t>(kCount));
+    check(!loads(badEntry), "越界的入口点被拒绝");
+
+    std::string badLevel = saved;
+    patch<std::int32_t>(badLevel, kEntryPointOffset + 4, 1000);
+    check(!loads(badLevel), "不合理的最高层数被拒绝");
+
+    const std::size_t level0Offset = kHeaderBytes + kCount * kDim * sizeof(float) + kCount;
+    std::string badSlotCount = saved;
+    patch<std::uint32_t>(badSlotCount, level0Offset, 2 * kM + 1);
+    check(!loads(badSlotCount), "第 0 层邻居数超过 2m 被拒绝");
+
+    std::string badNeighbor = saved;
+    patch<std::uint32_t>(badNeighbor, level0Offset + sizeof(std::uint32_t), static_cast<std::uint32_t>(kCount));
+    check(!loads(badNeighbor), "越界的邻居 id 被拒绝");
+
+    std::string badDeleted = saved;
+    badDeleted[kHeaderBytes + kCount * kDim * sizeof(float)] = 7;
+    check(!loads(badDeleted), "非法的删除标记被拒绝");
+
+    // 加载失败时保留原有内容
+    std::istringstream corrupted(badNeighbor);
+    check(!restored.load(corrupted) && restored.nodeCount() == kCount
+              && restored.search(vectors.data(), 1, 64) == original.search(vectors.data(), 1, 64),
+          "加载失败后已有索引保持不变");
+
+    return checks::finish();
+}
@@ -0,0 +1,34 @@
+#ifndef CHECK_SUPPORT_H
+#define CHECK_SUPPORT_H
+
+// Benchmark/ 下各独立校验程序共用：逐项打印结果，最后汇总为进程退出码
+#include <cstdio>
+
+namespace checks {
+
+inline int &failureCount()
+{
+    static int failures = 0;
+    return failures;
+}
+
+inline void check(bool condition, const char *what)
+{
+    std::printf("%s %s\n", condition ? "✓" : "✗", what);
+    failureCount() += condition ? 0 : 1;
+}
+
+// 打印汇总；全部通过时返回 0，作为 main 的返回值
+inline int finish()
+{
+    if (failureCount() == 0) {
+        std::printf("全部通过\n");
+        return 0;
+    }
+    std::printf("%d 项失败\n", failureCount());
+    return 1;
+}
+
+} // namespace checks
+
+#endif // CHECK_SUPPORT_H
@@ -0,0 +1,38 @@
+#ifndef CPUTOPOLOGY_H
+#define CPUTOPOLOGY_H
+
+#include <string>
+#include <vector>
+
+// CPU / NUMA 拓扑查询、线程绑核和推理库内部线程数设置（Linux，其他平台上绑核为空操作）
+class CpuTopology
+{
+public:
+    struct NumaNode
+    {
+        int id;
+        std::vector<int> cpus;
+    };
+
+    // 解析 / 生成 Linux cpulist 格式（如 "0-3,8,10-11"），非法片段被忽略
+    static std::vector<int> parseCpuList(const std::string &list);
+    static std::string formatCpuList(const std::vector<int> &cpus);
+
+    // 当前线程允许运行的 CPU（受 taskset / cgroup cpuset 限制）
+    static std::vector<int> allowedCpus();
+
+    // /sys/devices/system/node 下的 NUMA 节点；非 NUMA 机器返回空
+    static std::vector<NumaNode> numaNodes();
+
+    // 把当前线程绑定到给定 CPU 集合，之后由它创建的线程继承该集合
+    static bool pinCurrentThread(const std::vector<int> &cpus);
+
+    // 把 CPU 集合按顺序切成 parts 段（每段至少一个 CPU，CPU 数不足时循环复用）
+    static std::vector<std::vector<int>> partition(const std::vector<int> &cpus, int parts);
+
+    // 设置单次推理内部的并行线程数：OpenCV 并行后端，以及进程中已加载的 OpenBLAS / MKL（同时设置对应环境变量）；
+    // 返回实际生效的库名列表（如 "OpenCV,OpenBLAS"）
+    static std::string setIntraOpThreads(int threads);
+};
+
+#endif // CPUTOPOLOGY_H
@@ -0,0 +1,108 @@
+#ifndef DATABASECONNECTIONPOOL_H
+#define DATABASECONNECTIONPOOL_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QString>
+#include <QWaitCondition>
+#include <map>
+#include <memory>
+
+// 按线程分配的数据库连接池。
+// Qt SQL 的连接只能在创建它的线程中使用（QMYSQL 关闭连接时还会调用 mysql_thread_end 清理调用线程的状态），
+// 池为每个调用线程惰性创建一个独立命名的连接，同一线程嵌套 acquire() 得到的是同一个连接，
+// 连接只由所属线程关闭，因此每个连接与它的线程同生命周期：线程退出时由线程局部对象关闭，
+// 池不会回收仍在运行的线程的空闲连接（HTTP 工作线程数固定，连接数随之固定）。
+// 连接总数达到上限时新线程等待其他线程退出。
+class DatabaseConnectionPool
+{
+    struct Connection;
+
+public:
+    // RAII 租约：析构时把连接标记为空闲
+    class Lease
+    {
+    public:
+        Lease(Lease &&other) noexcept;
+        ~Lease();
+
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+        Lease &operator=(Lease &&) = delete;
+
+        // 连接无法建立时为 false，此时 database() 返回无效连接，在其上执行的查询会失败
+        bool isValid() const { return m_connection != nullptr; }
+        QSqlDatabase database() const;
+
+    private:
+        friend class DatabaseConnectionPool;
+        Lease(DatabaseConnectionPool *pool, Connection *connection);
+
+        DatabaseConnectionPool *m_pool;
+        Connection *m_connection;
+    };
+
+    DatabaseConnectionPool();
+    ~DatabaseConnectionPool();
+
+    DatabaseConnectionPool(const DatabaseConnectionPool &) = delete;
+    DatabaseConnectionPool &operator=(const DatabaseConnectionPool &) = delete;
+
+    // 连接参数，必须在第一次 acquire() 之前设置
+    void setDatabase(const QString &driver, const QString &host, int port, const QString &dbName,
+                     const QString &user, const QString &password);
+
+    // 同时打开的最多连接数，应不小于会访问数据库的线程数
+    void setMaxSize(int maxSize);
+
+    // 借出调用线程自己的连接：首次使用时建立，空闲较久的连接先用 SELECT 1 检查，失效时重连
+    Lease acquire();
+
+    int size() const;
+    int inUseCount() const;
+    int maxSize() const { return m_maxSize; }
+
+private:
+    struct Connection
+    {
+        QString name;
+        QSqlDatabase db;
+        int inUse = 0;          // 同一线程嵌套借出的层数
+        qint64 lastUsed = 0;    // m_clock 计时，毫秒
+    };
+
+    // 线程退出时经由它关闭该线程在池中的连接；池析构时把 pool 置空，之后退出的线程不再回调
+    struct Registration
+    {
+        QMutex mutex;
+        DatabaseConnectionPool *pool;
+    };
+    friend struct ThreadConnections;
+
+    using ConnectionMap = std::map<quint64, std::unique_ptr<Connection>>;
+
+    void release(Connection *connection);
+    bool open(Connection *connection);
+    bool ping(Connection *connection);
+    void discard(quint64 threadKey, Connection *connection);
+    void closeThreadConnection(quint64 threadKey);
+
+    QString m_driver;
+    QString m_host;
+    int m_port;
+    QString m_dbName;
+    QString m_user;
+    QString m_password;
+
+    int m_maxSize;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_closed;        // 有连接被关闭（连接数减少）
+    ConnectionMap m_connections;    // 键为线程序号，每个线程在首次 acquire() 时分配，不会复用
+    quint64 m_nextConnectionId;
+    QElapsedTimer m_clock;
+    std::shared_ptr<Registration> m_registration;
+};
+
+#endif // DATABASECONNECTIONPOOL_H
@@ -7,6 +7,15 @@
 #include <QSqlError>
 #include <QVector>
 #include <QVariantMap>
+#include <QPair>
+#include <QTimer>
+#include <QHash>
+#include <QDateTime>
+#include <QMutex>
+#include <atomic>
+#include <memory>
+#include "DatabaseConnectionPool.h"
+#include "UserAuthCache.h"
 
 class DatabaseManager : public QObject
 {
@@ -16,11 +25,27 @@ public:
     explicit DatabaseManager(QObject *parent = nullptr);
     ~DatabaseManager();
 
+    // 连接池设置（每个线程独立一个连接），必须在 initialize 之前调用，见 DatabaseConnectionPool
+    // maxSize 为同时打开的最多连接数
+    void setPoolOptions(int maxSize);
+
+    // 最近登录时间异步写入：登录时只记入内存（同一用户多次登录只保留最新时间），
+    // 每隔 flushIntervalMs 或积累 batchSize 个用户后合并成一条多行 UPDATE 写入；flushIntervalMs 为 0 时同步写入
+    void setLastLoginOptions(int flushIntervalMs, int batchSize);
+
+    // 认证记录缓存设置（capacityBytes 为 0 时关闭），见 UserAuthCache
+    void setAuthCacheOptions(qint64 capacityBytes, int ttlSeconds);
+    const UserAuthCache &authCache() const { return *m_authCache; }
+
     // 初始化数据库连接
     bool initialize(const QString &host, int port, const QString &dbName,
                    const QString &user, const QString &password);
 
-    // 用户操作
+    // 认证记录（是否存在、密码哈希、人脸特征）：先查缓存，未命中时一次查询读取并写入缓存；
+    // 查询失败时返回 exists 为 false 的记录
+    UserAuthRecord getAuthRecord(const QString &username);
+
+    // 用户操作（取自 getAuthRecord）
     bool userExists(const QString &username);
     
     // 插入用户
@@ -31,9 +56,12 @@ public:
     QString getUserPassword(const QString &username);
     QVariantMap getUserInfo(const QString &username);
     QVector<QVariantMap> getAllUsers();
+    QVector<QPair<QString, QVector<float>>> getAllDescriptors();
     
     // 更新用户数据
     bool updateLastLogin(const QString &username);
+    // 立即写入缓冲中的最近登录时间，退出前必须调用（析构时也会调用）
+    void flushLastLogins();
     bool updateUserPassword(const QString &username, const QString &newPasswordHash);
     bool updateUserDescriptor(const QString &username, const QVector<float> &newDescriptor);
     
@@ -43,12 +71,40 @@ public:
     // 统计
     int getUserCount();
 
+    // 把旧格式（QDataStream 序列化）的人脸特征分批改写为原始格式，返回改写的行数；
+    // 以旧值为条件更新，不会覆盖并发写入的新特征；stop 置位后在当前批次结束时返回
+    int migrateLegacyDescriptors(int batchSize, const std::atomic<bool> &stop);
+
+    // 连接池状态
+    int connectionCount() const { return m_pool.size(); }
+    int connectionsInUse() const { return m_pool.inUseCount(); }
+    int maxConnections() const { return m_pool.maxSize(); }
+
+signals:
+    // 用户人脸特征新增或变更（在调用线程中同步发出）；username 为数据库中保存的写法，
+    // 与 getAllDescriptors() 一致，和请求中的写法可能不同（如末尾空格）
+    void userDescriptorChanged(const QString &username, const QVector<float> &descriptor);
+    // 用户被删除
+    void userRemoved(const QString &username);
+
 private:
     bool createTables();
-    QByteArray descriptorToBlob(const QVector<float> &descriptor);
-    QVector<float> blobToDescriptor(const QByteArray &blob);
+    // 按用户名查找用户行，输出 id 和数据库中保存的用户名
+    bool findUserRow(QSqlDatabase db, const QString &username, int &id, QString &storedName);
+    // 人脸特征 BLOB 编解码：写入总是原始格式，读取兼容旧格式
+    static QByteArray descriptorToBlob(const QVector<float> &descriptor);
+    static QVector<float> blobToDescriptor(const QByteArray &blob);
+
+    DatabaseConnectionPool m_pool;
+    std::unique_ptr<UserAuthCache> m_authCache;
 
-    QSqlDatabase m_db;
+    // 待写入的最近登录时间
+    QMutex m_lastLoginMutex;
+    QHash<QString, QDateTime> m_pendingLogins;
+    bool m_lastLoginFlushQueued;
+    int m_lastLoginFlushMs;
+    int m_lastLoginBatchSize;
+    QTimer m_lastLoginTimer;
 };
 
 #endif // DATABASEMANAGER_H
@@ -0,0 +1,35 @@
+#ifndef DESCRIPTORBLOB_H
+#define DESCRIPTORBLOB_H
+
+#include <cstddef>
+
+// users.face_descriptor 列的编解码（不依赖 Qt，便于单独校验）。
+// 原始格式：每个 128 维特征 512 字节，小端 float 连续存放（模板集为其整数倍），长度总是 512 的倍数；
+// 旧格式（QDataStream）为 4 字节大端元素个数 + 大端 double（默认双精度写出 float），长度模 512 余 4，
+// 且元素个数与长度吻合。两种格式按长度区分。
+class DescriptorBlob
+{
+public:
+    enum class Format
+    {
+        Raw,
+        Legacy,
+        Unknown
+    };
+
+    static const int DIMENSION = 128;
+    static const std::size_t RAW_DESCRIPTOR_BYTES = DIMENSION * sizeof(float);
+
+    static Format detect(const char *data, std::size_t size);
+
+    // 解码后的 float 个数；Unknown 时为 0
+    static std::size_t elementCount(const char *data, std::size_t size);
+
+    // 写出原始格式，out 至少 count * sizeof(float) 字节
+    static void encode(const float *values, std::size_t count, char *out);
+
+    // 解码任一格式，out 至少 elementCount() 个 float；格式无法识别时返回 false
+    static bool decode(const char *data, std::size_t size, float *out);
+};
+
+#endif // DESCRIPTORBLOB_H
@@ -0,0 +1,53 @@
+#ifndef DESCRIPTORCACHE_H
+#define DESCRIPTORCACHE_H
+
+#include <QCache>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QRect>
+#include <QVector>
+#include <atomic>
+#include <cstddef>
+#include "FaceRecognizer.h"
+
+// 按图像内容哈希缓存特征提取结果（LRU + TTL），客户端重试同一张图像时跳过整条推理流水线。
+// 提取失败的结果（未检测到人脸、质量不合格等）同样缓存，内部错误不缓存。线程安全。
+class DescriptorCache
+{
+public:
+    // capacity 为 0 时不缓存
+    DescriptorCache(int capacity, int ttlSeconds);
+
+    bool isEnabled() const { return m_capacity > 0; }
+
+    // 图像原始字节与客户端人脸框共同决定缓存键
+    static quint64 hashKey(const char *data, std::size_t size, const QRect &faceHint);
+
+    // 命中且未过期时返回 true，并输出缓存的特征（失败结果为空特征）与失败原因
+    bool lookup(quint64 key, QVector<float> &descriptor, FaceError &error);
+    void insert(quint64 key, const QVector<float> &descriptor, FaceError error);
+
+    quint64 hits() const { return m_hits.load(); }
+    quint64 misses() const { return m_misses.load(); }
+    int size() const;
+
+private:
+    struct Entry
+    {
+        QVector<float> descriptor;
+        FaceError error;
+        qint64 expiresAt;   // m_clock 计时，毫秒
+    };
+
+    const int m_capacity;
+    const qint64 m_ttlMs;
+    QElapsedTimer m_clock;
+
+    mutable QMutex m_mutex;
+    QCache<quint64, Entry> m_entries;
+
+    std::atomic<quint64> m_hits{0};
+    std::atomic<quint64> m_misses{0};
+};
+
+#endif // DESCRIPTORCACHE_H
@@ -0,0 +1,69 @@
+#ifndef DISTANCEKERNELS_H
+#define DISTANCEKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+// 按 Alignment 字节对齐的分配器，让特征矩阵的每一行都从缓存行边界开始
+template <typename T, std::size_t Alignment = 64>
+struct AlignedAllocator
+{
+    using value_type = T;
+
+    template <typename U>
+    struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+    AlignedAllocator() noexcept = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) noexcept {}
+
+    T *allocate(std::size_t n)
+    {
+        return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T *p, std::size_t) noexcept
+    {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment> &) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment> &) const noexcept { return false; }
+};
+
+using AlignedFloatVector = std::vector<float, AlignedAllocator<float>>;
+using AlignedInt8Vector = std::vector<std::int8_t, AlignedAllocator<std::int8_t>>;
+
+// 特征向量距离计算内核：运行时按 CPU 支持的指令集（AVX-512 / AVX2+FMA / SSE）选择实现
+class DistanceKernels
+{
+public:
+    // 两个向量的欧氏距离平方
+    static float squaredL2(const float *a, const float *b, int dim);
+
+    // 同上，但按维度顺序用 double 累加，结果与指令集无关、每次都相同；
+    // 用于接受/拒绝判断等需要确定结果的场合，SIMD 版本只用于扫描和排序
+    static double squaredL2Exact(const float *a, const float *b, int dim);
+
+    // 一个查询向量对 count 行（行主序，行距为 dim）逐一计算欧氏距离平方，写入 out[count]
+    static void squaredL2Batch(const float *query, const float *rows, std::size_t count, int dim, float *out);
+
+    // 查询向量对 count 行按维缩放的 int8 量化向量计算近似欧氏距离平方：
+    // 第 d 维还原值为 scales[d] * codes[row * dim + d]
+    static void squaredL2Int8Batch(const float *query, const std::int8_t *codes, const float *scales,
+                                   std::size_t count, int dim, float *out);
+
+    // 从 values[count] 中选出最小的 k 个，按值升序写入 result（值, 下标）
+    static void selectTopK(const float *values, std::size_t count, int k,
+                           std::vector<std::pair<float, std::uint32_t>> &result);
+
+    // 当前使用的指令集名称，用于启动日志
+    static const char *isaName();
+};
+
+#endif // DISTANCEKERNELS_H
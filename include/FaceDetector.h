@@ -0,0 +1,35 @@
+#ifndef FACEDETECTOR_H
+#define FACEDETECTOR_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <dlib/geometry/rectangle.h>
+
+// 人脸检测后端接口：HOG（dlib 默认）、MMOD（dlib CNN）和 YuNet（OpenCV DNN）。
+// 不依赖 Qt，Benchmark 目标可以直接链接。单个实例非线程安全，每个识别器副本持有一份 clone()。
+class FaceDetector
+{
+public:
+    virtual ~FaceDetector() = default;
+
+    // 按名称创建检测器（"hog" / "mmod" / "yunet"）；modelPath 为空时使用 models/ 下的默认模型。
+    // 名称未知、模型无法加载或当前 OpenCV 不支持该后端时抛出 std::runtime_error
+    static std::unique_ptr<FaceDetector> create(const std::string &backend, const std::string &modelPath = std::string());
+
+    // 最长边超过 maxSide 时先缩小再检测（0 表示原图检测）；grayscale 为 true 且后端支持时在灰度图上检测。
+    // 返回原图坐标下的人脸框
+    std::vector<dlib::rectangle> detect(const cv::Mat &bgrImage, int maxSide = 0, bool grayscale = false);
+
+    // 直接在给定图像上检测，不缩放；image 为 BGR 三通道，acceptsGrayscale() 为 true 时也可以是单通道灰度图
+    virtual std::vector<dlib::rectangle> detectRaw(const cv::Mat &image) = 0;
+
+    virtual std::string name() const = 0;
+    virtual bool acceptsGrayscale() const = 0;
+
+    // 复制一份独立的检测器（共享只读的模型参数，推理缓冲区各自一份）
+    virtual std::unique_ptr<FaceDetector> clone() const = 0;
+};
+
+#endif // FACEDETECTOR_H
@@ -0,0 +1,55 @@
+#ifndef FACEEMBEDDINGBATCHER_H
+#define FACEEMBEDDINGBATCHER_H
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "FaceRecognizer.h"
+
+// 跨请求的人脸切片微批处理：把并发请求的 150x150 切片攒成一批送入 ResNet
+class FaceEmbeddingBatcher
+{
+public:
+    // maxBatchSize: 单批最多切片数；windowMicros: 负载较高时最多等待凑批的时间；
+    // workerCount: 并行的推理线程数，每个线程持有一份网络副本；
+    // cpus 非空时把它按顺序切成 workerCount 段，每个推理线程绑定其中一段
+    FaceEmbeddingBatcher(const anet_type &net, int maxBatchSize, int windowMicros, int workerCount = 1,
+                         const std::vector<int> &cpus = std::vector<int>());
+    ~FaceEmbeddingBatcher();
+
+    FaceEmbeddingBatcher(const FaceEmbeddingBatcher &) = delete;
+    FaceEmbeddingBatcher &operator=(const FaceEmbeddingBatcher &) = delete;
+
+    // 提交一个切片，返回的 future 在所属批次推理完成后就绪
+    std::future<dlib::matrix<float, 0, 1>> submit(dlib::matrix<dlib::rgb_pixel> &&chip);
+
+    // 预热：每个推理线程的网络各跑一次满批前向传播，提前完成张量分配和权重缺页；
+    // 推理线程此时必须空闲，只能在开始接收请求之前调用
+    void warmUp();
+
+private:
+    struct PendingChip
+    {
+        dlib::matrix<dlib::rgb_pixel> chip;
+        std::promise<dlib::matrix<float, 0, 1>> promise;
+    };
+
+    void run(anet_type &net, const std::vector<int> &cpus);
+
+    const size_t m_maxBatchSize;
+    const std::chrono::microseconds m_window;
+
+    std::vector<std::unique_ptr<anet_type>> m_nets;
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_queueChanged;
+    std::deque<PendingChip> m_queue;
+    bool m_stopping;
+};
+
+#endif // FACEEMBEDDINGBATCHER_H
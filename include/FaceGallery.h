@@ -0,0 +1,106 @@
+#ifndef FACEGALLERY_H
+#define FACEGALLERY_H
+
+#include <QHash>
+#include <QPair>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "DistanceKernels.h"
+#include "FloatRowStore.h"
+#include "HnswIndex.h"
+
+// 1:N 检索结果
+struct GalleryMatch
+{
+    QString username;
+    double distance;
+};
+
+// 内存人脸库：所有用户的 128-d 特征按行连续存放，供 1:N 检索使用。
+// 用户数达到阈值后额外维护一份 HNSW 索引，检索改走近似最近邻。
+// 运行中需要重建索引时（用户数首次达到阈值、删除标记过多）在后台线程建图，期间检索照常进行，
+// 建好后在写锁内补上建图期间的变更再替换。
+class FaceGallery
+{
+public:
+    static const int DIMENSION = 128;
+
+    FaceGallery() = default;
+    ~FaceGallery();
+
+    // 启用 HNSW 索引：用户数不少于 minUsers 时生效；indexPath 非空时先尝试加载已保存的索引
+    void enableIndex(int minUsers, int m, int efConstruction, int efSearch,
+                     const QString &indexPath = QString());
+    // 调整检索时的候选集大小（召回率/延迟权衡），可在运行时修改
+    void setEfSearch(int efSearch);
+
+    // 启用 int8 量化扫描：精确检索时先在量化向量上粗筛 k * rerankFactor 个候选，
+    // 再用原始 float 特征精确重排；无论哪种检索方式，返回的距离都与 computeDistance 的结果逐位一致
+    void enableQuantization(int rerankFactor);
+
+    // 把 float 特征移到 directory 下的临时文件映射中，常驻内存的只剩 int8 量化特征（每个用户 128 字节）；
+    // 只在启用量化扫描后有意义（逐行扫描 float 特征时每次检索都会读遍整个文件）。失败时返回 false
+    bool spillFloatRows(const QString &directory);
+
+    // 索引持久化：文件中记录人脸库内容指纹，加载时不一致则丢弃并重建
+    bool saveIndex(const QString &path) const;
+
+    // 用数据库中的全部特征重建人脸库；特征为模板集时只取其中的质心（前 DIMENSION 维）
+    void load(const QVector<QPair<QString, QVector<float>>> &entries);
+
+    // 新增或替换用户特征（同样只取模板集的质心）
+    void upsert(const QString &username, const QVector<float> &descriptor);
+    void remove(const QString &username);
+
+    // 返回距离最近的 k 个用户，按距离升序
+    QVector<GalleryMatch> search(const QVector<float> &query, int k) const;
+
+    int size() const;
+
+private:
+    void rebuildIndexLocked();
+    void scheduleRebuildLocked();
+    void finishRebuild(quint64 generation, std::unique_ptr<HnswIndex> index, const QVector<QString> &labels);
+    void indexChangedLocked(const QString &username);
+    static std::unique_ptr<HnswIndex> buildIndex(const QVector<QString> &usernames, const float *descriptors,
+                                                 int m, int efConstruction);
+    bool loadIndexLocked(const QString &path);
+    void indexInsertLocked(const QString &username, const float *descriptor);
+    quint64 fingerprintLocked() const;
+    void requantizeLocked();
+    bool quantizeRowLocked(int row);
+    void quantizeUpsertedRowLocked(int row);
+    QVector<GalleryMatch> searchExactLocked(const QVector<float> &query, int k) const;
+
+    mutable QReadWriteLock m_lock;
+    FloatRowStore m_descriptors{DIMENSION};   // 行主序，每行 DIMENSION 个 float
+    QVector<QString> m_usernames;       // 第 i 行对应的用户名
+    QHash<QString, int> m_rows;         // 用户名 -> 行号
+
+    bool m_quantized = false;
+    int m_rerankFactor = 4;
+    std::vector<float> m_scales;        // 每一维的量化步长
+    AlignedInt8Vector m_codes;          // 与 m_descriptors 行对应的 int8 量化特征
+    int m_clampedRows = 0;              // 上次确定步长之后，超出量化范围被截断的行数
+
+    int m_indexMinUsers = -1;           // -1 表示未启用索引
+    int m_indexM = 16;
+    int m_indexEfConstruction = 200;
+    std::atomic<int> m_efSearch{64};
+    std::unique_ptr<HnswIndex> m_index;
+    QVector<QString> m_indexLabels;     // 索引节点 id -> 用户名
+    QHash<QString, quint32> m_indexIds; // 用户名 -> 当前有效的索引节点 id
+
+    std::thread m_rebuildThread;        // 后台重建线程
+    bool m_rebuilding = false;
+    quint64 m_indexGeneration = 0;      // load() 时递增，丢弃基于旧数据的重建结果
+    QSet<QString> m_rebuildDirty;       // 后台建图期间新增、变更或删除的用户
+};
+
+#endif // FACEGALLERY_H
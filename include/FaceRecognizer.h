@@ -4,11 +4,16 @@
 #include <QObject>
 #include <QVector>
 #include <QString>
+#include <QRect>
+#include <QByteArray>
 #include <opencv2/opencv.hpp>
 #include <dlib/opencv.h>
-#include <dlib/image_processing/frontal_face_detector.h>
 #include <dlib/image_processing.h>
 #include <dlib/dnn.h>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include "FaceDetector.h"
 
 // dlib 人脸识别网络模板定义
 template <template <int,template<typename>class,int,typename> class block, int N, 
@@ -41,31 +46,179 @@ using anet_type = dlib::loss_metric<dlib::fc_no_bias<128,dlib::avg_pool_everythi
                             dlib::input_rgb_image_sized<150>
                             >>>>>>>>>>>>;
 
+class FaceEmbeddingBatcher;
+
+// 单人脸特征提取失败的原因
+enum class FaceError
+{
+    None,
+    DecodeFailed,   // 图像无法解码
+    NoFace,         // 未检测到人脸
+    FaceTooSmall,   // 人脸太小
+    TooBlurry,      // 人脸区域模糊
+    TooDark,        // 人脸区域过暗
+    TooBright,      // 人脸区域过亮
+    PoseTooLarge,   // 侧脸角度过大
+    Inconsistent,   // 多张注册图像不是同一个人
+    Internal        // 模型未加载或推理异常
+};
+
+// 质量预检参数：在关键点定位之后、ResNet 推理之前拒绝无法识别的输入，阈值为 0 表示不检查该项
+struct FaceQualityOptions
+{
+    bool enabled = true;
+    int minFaceSize = 80;           // 人脸框最短边（原图像素）
+    double minSharpness = 40.0;     // 人脸区域（缩放到最宽 128 像素）的拉普拉斯方差
+    int minBrightness = 40;         // 人脸区域平均灰度下限
+    int maxBrightness = 220;        // 人脸区域平均灰度上限
+    double maxYawAsymmetry = 0.5;   // 鼻尖到两眼外眼角水平距离之差与之和的比值，正脸约为 0
+};
+
+// 一段已编码图像（JPEG/PNG 等）的字节，不持有数据
+struct ImageBuffer
+{
+    const char *data;
+    std::size_t size;
+};
+
+// 多人脸提取结果：人脸框（原图像素坐标）及其 128-d 特征
+struct FaceDetection
+{
+    QRect box;
+    QVector<float> descriptor;
+};
+
 class FaceRecognizer : public QObject
 {
     Q_OBJECT
 
 public:
+    // 判定为同一人的最大欧氏距离: dlib 推荐 0.6,这里用 0.45 更严格
+    static constexpr double MATCH_THRESHOLD = 0.45;
+
     explicit FaceRecognizer(QObject *parent = nullptr);
     ~FaceRecognizer();
 
-    // 加载 dlib 模型
-    bool loadModels(const QString &shapePredictorPath, const QString &faceRecModelPath);
+    // 加载 dlib 模型（关键点模型与识别网络并行加载）；
+    // shapePredictorCachePath 非空时关键点模型优先从预解析缓存加载，见 ShapePredictorCache
+    bool loadModels(const QString &shapePredictorPath, const QString &faceRecModelPath,
+                    const QString &shapePredictorCachePath = QString());
+
+    // 从已加载的识别器复制模型（关键点模型只读共享，检测器与网络各自独立一份）；
+    // withRecognitionNet 为 false 时不复制识别网络，特征必须由微批处理器计算（见 setEmbeddingBatcher）
+    bool cloneModelsFrom(const FaceRecognizer &source, bool withRecognitionNet = true);
+
+    // 替换人脸检测后端（默认 HOG），见 FaceDetector
+    void setFaceDetector(std::unique_ptr<FaceDetector> detector);
+    const FaceDetector &faceDetector() const { return *m_faceDetector; }
+
+    // 设置后 128-d 特征改由微批处理器计算，传 nullptr 恢复使用本副本的网络
+    void setEmbeddingBatcher(FaceEmbeddingBatcher *batcher);
+    const anet_type &faceRecNet() const { return m_faceRecNet; }
+
+    // 人脸检测分辨率：最长边超过 maxSide 时先缩小再检测（0 表示原图检测），
+    // grayscale 为 true 时在灰度图上检测；检测框映射回原图后再做关键点和切片
+    void setDetectionOptions(int maxSide, bool grayscale);
+
+    // JPEG 按比例解码：最长边是 targetSide 的 2/4/8 倍以上时直接在 DCT 域缩小解码（0 表示总是全尺寸解码）；
+    // 客户端人脸框按同样比例换算
+    void setDecodeTargetSide(int targetSide);
+
+    // 质量预检设置，见 FaceQualityOptions
+    void setQualityOptions(const FaceQualityOptions &options);
+
+    // 最近一次 extractDescriptorFrom* 调用的失败原因（成功时为 FaceError::None）
+    FaceError lastError() const { return m_lastError; }
+    // 机器可读的错误码（如 "FACE_TOO_BLURRY"）和给用户看的提示
+    static QString errorCode(FaceError error);
+    static QString errorMessage(FaceError error);
     
-    // 从 base64 图像提取 128-d 人脸特征向量
-    QVector<float> extractDescriptorFromBase64(const QString &base64Image);
+    // 从 base64 图像提取 128-d 人脸特征向量；
+    // faceHint 为客户端检测到的人脸框（原图像素坐标），校验通过时跳过全图人脸检测
+    QVector<float> extractDescriptorFromBase64(const QString &base64Image, const QRect &faceHint = QRect());
+
+    // 从原始图像字节（JPEG/PNG 等）提取特征向量：直接在调用方的缓冲区上解码，不做拷贝
+    QVector<float> extractDescriptorFromBytes(const char *data, std::size_t size, const QRect &faceHint = QRect());
+
+    // 连拍登录：逐帧提取特征，只在首帧（或跟踪丢失时）做人脸检测，其余帧用 correlation_tracker 跟踪人脸；
+    // 每得到一帧特征就调用 accept(帧序号, 特征)，返回 true 时立即停止处理剩余帧。
+    // 返回实际处理的帧数；所有帧都没能提取到特征时 lastError() 给出最后一帧的失败原因
+    int extractDescriptorsFromBurst(const std::vector<ImageBuffer> &frames,
+                                    const std::function<bool(int, const QVector<float> &)> &accept);
+
+    // 注册模板集：多张图像各取第一个人脸的特征。解码、检测、关键点和切片在调用线程上逐张完成，
+    // 切片全部提交后一起等待（启用微批处理时与其他请求合批推理，否则按一批调用本副本的网络）。
+    // faceHints[i] 为第 i 张图像的客户端人脸框（可为空或短于 images）；
+    // 返回与 images 等长的特征，失败项为空，errors[i] 给出原因
+    QVector<QVector<float>> extractDescriptorsFromImages(const std::vector<ImageBuffer> &images,
+                                                         const std::vector<QRect> &faceHints,
+                                                         std::vector<FaceError> &errors);
+
+    // 解码 base64 图像字符串（可带 data:image/...;base64, 前缀）为原始字节
+    static QByteArray decodeBase64Image(const QString &base64String);
+
+    // 提取图像中所有人脸的特征：只解码、检测一次，所有切片合并为一批送入网络。
+    // 未通过质量预检的人脸不返回；返回空时 lastError() 给出原因（解码失败、没有人脸或全部未通过预检）
+    QVector<FaceDetection> extractAllDescriptorsFromBase64(const QString &base64Image);
+    QVector<FaceDetection> extractAllDescriptorsFromBytes(const char *data, std::size_t size);
     
+    // 预热：用合成图像依次走一遍解码、检测、关键点、切片和本副本网络的前向传播，
+    // 提前完成惰性分配和模型权重缺页，避免上线后的首批请求出现延迟尖峰
+    void warmUp();
+
     // 计算两个特征向量的欧氏距离
     static double computeDistance(const QVector<float> &desc1, const QVector<float> &desc2);
 
+    // 人脸模板集：单张图像时就是 128-d 特征本身；多张图像时为 [质心 | 模板1 | ... | 模板n] 连续存放，
+    // 整体存入 face_descriptor，登录时无需额外查询
+    static const int DESCRIPTOR_SIZE = 128;
+    static QVector<float> buildTemplateSet(const QVector<QVector<float>> &descriptors);
+    static int templateCount(const QVector<float> &templateSet);
+
+    // 特征与模板集中每个模板距离的最小值（单模板时等同于 computeDistance）
+    static double computeMinDistance(const QVector<float> &descriptor, const QVector<float> &templateSet);
+
 private:
     bool m_modelsLoaded;
-    dlib::frontal_face_detector m_faceDetector;
-    dlib::shape_predictor m_shapePredictor;
+    std::unique_ptr<FaceDetector> m_faceDetector;
+    std::shared_ptr<const dlib::shape_predictor> m_shapePredictor;
     anet_type m_faceRecNet;
+    FaceEmbeddingBatcher *m_embeddingBatcher;
+    int m_detectionMaxSide;
+    bool m_detectionGrayscale;
+    int m_decodeTargetSide;
+    FaceQualityOptions m_qualityOptions;
+    FaceError m_lastError;
     
     // 辅助：base64 转 cv::Mat
-    cv::Mat base64ToMat(const QString &base64String);
+    // reduction 输出解码时的缩小倍数（1/2/4/8），原图坐标 = 解码后坐标 * reduction
+    cv::Mat base64ToMat(const QString &base64String, int &reduction);
+    cv::Mat decodeImage(const char *data, std::size_t size, int &reduction);
+
+    // 在已解码的 BGR 图像上完成检测、关键点定位和特征提取
+    QVector<float> extractDescriptor(const cv::Mat &cvImage, const QRect &faceHint, int reduction);
+    QVector<FaceDetection> extractAllDescriptors(const cv::Mat &cvImage, int reduction);
+
+    // 辅助：定位要提取的人脸关键点，优先使用客户端人脸框（原图坐标），否则取全图检测到的第一个人脸
+    FaceError locateFace(const cv::Mat &cvImage, const QRect &faceHint, int reduction,
+                         dlib::full_object_detection &shape);
+
+    // 辅助：已定位关键点之后的质量预检和 150x150 切片
+    FaceError prepareChip(const cv::Mat &cvImage, const dlib::full_object_detection &shape, int reduction,
+                          dlib::matrix<dlib::rgb_pixel> &faceChip);
+
+    // 辅助：质量预检、切片和特征计算，失败时设置 m_lastError
+    QVector<float> describeFace(const cv::Mat &cvImage, const dlib::full_object_detection &shape, int reduction);
+
+    // 辅助：根据人脸区域和关键点做质量预检
+    FaceError checkQuality(const cv::Mat &bgrImage, const dlib::full_object_detection &shape, int reduction) const;
+
+    // 辅助：在（可能缩小的）图像上检测人脸，返回原图坐标下的人脸框
+    std::vector<dlib::rectangle> detectFaces(const cv::Mat &bgrImage);
+
+    // 辅助：只在客户端人脸框附近的小块区域里检测人脸并检查关键点是否落在框内，
+    // 通过时输出关键点，否则返回 false 由调用方回退到全图检测
+    bool locateFaceFromHint(const cv::Mat &bgrImage, const QRect &faceHint, dlib::full_object_detection &shape);
 };
 
 #endif // FACERECOGNIZER_H
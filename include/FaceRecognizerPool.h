@@ -0,0 +1,78 @@
+#ifndef FACERECOGNIZERPOOL_H
+#define FACERECOGNIZERPOOL_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QString>
+#include <memory>
+#include <vector>
+#include "FaceRecognizer.h"
+
+// FaceRecognizer 副本池：每个 HTTP 工作线程在请求期间独占一个副本
+class FaceRecognizerPool
+{
+public:
+    // RAII 租约：析构时自动把副本归还给池
+    class Lease
+    {
+    public:
+        Lease(Lease &&other) noexcept;
+        ~Lease();
+
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+        Lease &operator=(Lease &&) = delete;
+
+        FaceRecognizer *operator->() const { return m_recognizer; }
+        FaceRecognizer &operator*() const { return *m_recognizer; }
+
+    private:
+        friend class FaceRecognizerPool;
+        Lease(FaceRecognizerPool *pool, FaceRecognizer *recognizer);
+
+        FaceRecognizerPool *m_pool;
+        FaceRecognizer *m_recognizer;
+    };
+
+    explicit FaceRecognizerPool(int size);
+    ~FaceRecognizerPool();
+
+    // 加载一次模型，再复制到其余副本。
+    // cloneRecognitionNet 为 false 时（特征将由微批处理器计算）其余副本不复制 ResNet，
+    // 只有第一个副本保留一份供微批处理器复制，每个副本省下一整份网络权重
+    bool loadModels(const QString &shapePredictorPath, const QString &faceRecModelPath,
+                    const QString &shapePredictorCachePath = QString(), bool cloneRecognitionNet = true);
+
+    // 所有副本改用同一个微批处理器计算特征；传 nullptr 时恢复各副本自己的网络（没有复制过的此时补上）
+    void setEmbeddingBatcher(FaceEmbeddingBatcher *batcher);
+
+    // 所有副本换用同一种检测后端，每个副本持有 prototype 的一份 clone()
+    void setFaceDetector(const FaceDetector &prototype);
+
+    // 所有副本使用相同的检测分辨率设置
+    void setDetectionOptions(int maxSide, bool grayscale);
+    void setDecodeTargetSide(int targetSide);
+    void setQualityOptions(const FaceQualityOptions &options);
+
+    // 所有副本并行预热，返回前全部完成；只能在开始接收请求之前调用
+    void warmUp();
+
+    // 第一个副本，模型从它复制而来
+    const FaceRecognizer &primary() const { return *m_replicas.front(); }
+
+    // 借出一个空闲副本，没有空闲副本时阻塞等待
+    Lease acquire();
+
+    int size() const;
+
+private:
+    void release(FaceRecognizer *recognizer);
+
+    std::vector<std::unique_ptr<FaceRecognizer>> m_replicas;
+    std::vector<FaceRecognizer *> m_idle;
+    bool m_netsCloned;
+    QMutex m_mutex;
+    QWaitCondition m_available;
+};
+
+#endif // FACERECOGNIZERPOOL_H
@@ -0,0 +1,54 @@
+#ifndef FLOATROWSTORE_H
+#define FLOATROWSTORE_H
+
+#include <cstddef>
+#include <string>
+#include "DistanceKernels.h"
+
+// 定长 float 行的连续存储（行主序，行距为 dim）。
+// 默认放在进程内存中；spillToDirectory() 后改为映射到磁盘上的临时文件，
+// 不常访问的行可以被内核换出，不再常驻内存（人脸库只在精确重排时读取少数几行）。
+// 非线程安全：data()/row() 返回的指针在 append/reserve 之后可能失效，调用方需要加锁。
+class FloatRowStore
+{
+public:
+    explicit FloatRowStore(std::size_t dim);
+    ~FloatRowStore();
+
+    FloatRowStore(const FloatRowStore &) = delete;
+    FloatRowStore &operator=(const FloatRowStore &) = delete;
+
+    // 把已有的行移到 directory 下新建的临时文件中（创建后立即删除目录项，进程退出后不留文件）；
+    // 失败或平台不支持时返回 false，继续使用内存存储
+    bool spillToDirectory(const std::string &directory);
+    bool isFileBacked() const { return m_mapped != nullptr; }
+
+    std::size_t dimension() const { return m_dim; }
+    std::size_t rowCount() const { return m_rows; }
+
+    const float *data() const { return m_mapped != nullptr ? m_mapped : m_memory.data(); }
+    float *row(std::size_t index) { return mutableData() + index * m_dim; }
+    const float *row(std::size_t index) const { return data() + index * m_dim; }
+
+    void append(const float *values);
+    // 只保留前 rows 行
+    void truncate(std::size_t rows);
+    void clear() { truncate(0); }
+    void reserve(std::size_t rows);
+
+private:
+    float *mutableData() { return m_mapped != nullptr ? m_mapped : m_memory.data(); }
+    bool remap(std::size_t capacity);
+    void unmap();
+
+    std::size_t m_dim;
+    std::size_t m_rows;
+    AlignedFloatVector m_memory;
+
+    // 文件映射
+    int m_fd;
+    float *m_mapped;
+    std::size_t m_capacity;   // 映射容量（行）
+};
+
+#endif // FLOATROWSTORE_H
@@ -0,0 +1,75 @@
+#ifndef HNSWINDEX_H
+#define HNSWINDEX_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <random>
+#include <utility>
+#include <vector>
+#include "DistanceKernels.h"
+
+// HNSW（分层可导航小世界图）近似最近邻索引
+// 节点 id 从 0 开始连续分配；删除只做标记，被删除节点仍参与图遍历但不会出现在结果中。
+// 非线程安全：并发读可以同时进行，写操作需要调用方加写锁。
+class HnswIndex
+{
+public:
+    // m: 上层每个节点的最大连接数（第 0 层为 2m）；efConstruction: 建图时的候选集大小
+    HnswIndex(int dim, int m = 16, int efConstruction = 200, unsigned seed = 42);
+
+    // 插入向量，返回分配的节点 id
+    std::uint32_t insert(const float *vector);
+    void markDeleted(std::uint32_t id);
+    bool isDeleted(std::uint32_t id) const { return m_deleted[id] != 0; }
+
+    // 返回最近的 k 个未删除节点（欧氏距离平方, id），按距离升序；
+    // efSearch 越大召回率越高、延迟越大
+    std::vector<std::pair<float, std::uint32_t>> search(const float *query, int k, int efSearch) const;
+
+    const float *vectorAt(std::uint32_t id) const { return m_vectors.data() + static_cast<std::size_t>(id) * m_dim; }
+    int dimension() const { return m_dim; }
+    std::size_t nodeCount() const { return m_levels.size(); }
+    std::size_t deletedCount() const { return m_deletedCount; }
+
+    // 二进制序列化（本机字节序）；load 校验文件中的尺寸和节点 id，不合法时返回 false 且保持原索引不变
+    void save(std::ostream &out) const;
+    bool load(std::istream &in);
+
+private:
+    using Candidate = std::pair<float, std::uint32_t>;
+
+    int randomLevel();
+    float distanceTo(const float *query, std::uint32_t id) const;
+    std::uint32_t greedyClosest(const float *query, std::uint32_t entry, int fromLevel, int toLevel) const;
+    std::vector<Candidate> searchLayer(const float *query, std::uint32_t entry, std::size_t ef,
+                                       int level, bool skipDeleted) const;
+    std::vector<std::uint32_t> selectNeighbors(const std::vector<Candidate> &sortedCandidates,
+                                               std::size_t maxCount) const;
+    void addLink(std::uint32_t node, std::uint32_t neighbor, int level);
+
+    std::vector<std::uint32_t> neighbors(std::uint32_t node, int level) const;
+    void setNeighbors(std::uint32_t node, int level, const std::vector<std::uint32_t> &links);
+    const std::uint32_t *neighborData(std::uint32_t node, int level, std::size_t &count) const;
+
+    int m_dim;
+    std::size_t m_maxM;
+    std::size_t m_maxM0;
+    std::size_t m_efConstruction;
+    double m_levelMultiplier;
+    std::mt19937 m_rng;
+
+    AlignedFloatVector m_vectors;
+    std::vector<int> m_levels;
+    std::vector<std::uint8_t> m_deleted;
+    std::size_t m_deletedCount;
+
+    // 第 0 层邻接表平铺存放：每个节点占 m_maxM0 + 1 个槽位，第一个槽位是邻居数
+    std::vector<std::uint32_t> m_level0Links;
+    // 第 1 层及以上的邻接表，只有极少数节点有
+    std::vector<std::vector<std::vector<std::uint32_t>>> m_upperLinks;
+
+    std::uint32_t m_entryPoint;
+    int m_maxLevel;
+};
+
+#endif // HNSWINDEX_H
@@ -0,0 +1,19 @@
+#ifndef SHAPEPREDICTORCACHE_H
+#define SHAPEPREDICTORCACHE_H
+
+#include <QString>
+#include <dlib/image_processing.h>
+
+// 68 点关键点模型的预解析缓存。
+// dlib 原始格式逐个解码可移植编码的浮点数，约 100 MB 的模型需要数秒；
+// 缓存文件以本机字节序平铺存放初始形状、每级的采样像素坐标和回归树，通过内存映射读取。
+// 缓存头部记录原始模型文件的大小和修改时间，不一致时重新解析原始模型并覆盖缓存。
+class ShapePredictorCache
+{
+public:
+    // 加载关键点模型：cachePath 为空时只读取原始模型；缓存缺失或过期时读取原始模型并重写缓存。
+    // 原始模型无法读取时抛出 dlib::serialization_error
+    static void load(const QString &modelPath, const QString &cachePath, dlib::shape_predictor &predictor);
+};
+
+#endif // SHAPEPREDICTORCACHE_H
@@ -0,0 +1,79 @@
+#ifndef USERAUTHCACHE_H
+#define USERAUTHCACHE_H
+
+#include <QCache>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// 用户认证记录：是否存在、密码哈希和已解码的人脸特征（模板集）
+struct UserAuthRecord
+{
+    bool exists = false;
+    QString passwordHash;
+    QVector<float> descriptor;
+
+    bool hasPassword() const { return !passwordHash.isEmpty(); }
+    bool hasFace() const { return !descriptor.isEmpty(); }
+};
+
+// 按用户名缓存认证记录（分片 LRU + TTL），登录时不必每次查询数据库。
+// 缓存键忽略大小写和末尾空格；username 列（utf8mb4_unicode_ci）还会把重音、全角等写法视为同一用户，
+// 这类写法与库中用户名的缓存键不同，由 DatabaseManager 直接查库、不放入缓存（见 sameKey），
+// 因此一个用户只有库中用户名对应的一个缓存项。
+// 不存在的用户同样缓存；DatabaseManager 在写入用户数据后按库中的用户名调用 invalidate，
+// 与写入并发的读取不会把旧记录放回缓存（见 lookup 的 generation）。线程安全。
+class UserAuthCache
+{
+public:
+    // capacityBytes 为 0 时不缓存；按记录的近似内存占用计算容量
+    UserAuthCache(qint64 capacityBytes, int ttlSeconds, int shardCount = 16);
+
+    bool isEnabled() const { return m_capacityBytes > 0; }
+
+    // 命中且未过期时返回 true 并输出记录；未命中时输出所在分片的版本号，加载后原样传给 insert
+    bool lookup(const QString &username, UserAuthRecord &record, quint64 &generation);
+
+    // generation 之后该分片有过 invalidate 时放弃写入（加载期间记录可能已被修改）
+    void insert(const QString &username, const UserAuthRecord &record, quint64 generation);
+
+    void invalidate(const QString &username);
+
+    // username 与库中保存的用户名 storedName 是否对应同一个缓存键
+    static bool sameKey(const QString &username, const QString &storedName);
+
+    quint64 hits() const { return m_hits.load(); }
+    quint64 misses() const { return m_misses.load(); }
+    int size() const;
+    qint64 bytes() const;
+
+private:
+    struct Entry
+    {
+        UserAuthRecord record;
+        qint64 expiresAt;   // m_clock 计时，毫秒
+    };
+
+    struct Shard
+    {
+        mutable QMutex mutex;
+        QCache<QString, Entry> entries;
+        quint64 generation = 0;
+    };
+
+    Shard &shardFor(const QString &key);
+
+    const qint64 m_capacityBytes;
+    const qint64 m_ttlMs;
+    QElapsedTimer m_clock;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+
+    std::atomic<quint64> m_hits{0};
+    std::atomic<quint64> m_misses{0};
+};
+
+#endif // USERAUTHCACHE_H
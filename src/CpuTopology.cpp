@@ -0,0 +1,172 @@
+#include "CpuTopology.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <opencv2/core/utility.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// 推理库在进程启动时就按环境变量创建好线程池，之后修改环境变量不再生效，只能调用各自的运行时接口；
+// 以弱符号引用，没有链接对应的库时为空指针
+extern "C" {
+void openblas_set_num_threads(int threads) __attribute__((weak));
+void MKL_Set_Num_Threads(int threads) __attribute__((weak));
+}
+
+std::vector<int> CpuTopology::parseCpuList(const std::string &list)
+{
+    std::vector<int> cpus;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+        char *end = nullptr;
+        long first = std::strtol(range.c_str(), &end, 10);
+        long last = first;
+        if (end == range.c_str() || first < 0) {
+            continue;
+        }
+        if (*end == '-') {
+            const char *lastBegin = end + 1;
+            last = std::strtol(lastBegin, &end, 10);
+            if (end == lastBegin || last < first) {
+                continue;
+            }
+        }
+        for (long cpu = first; cpu <= last && cpu < 4096; ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+std::string CpuTopology::formatCpuList(const std::vector<int> &cpus)
+{
+    std::string list;
+    for (std::size_t i = 0; i < cpus.size();) {
+        std::size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+            ++j;
+        }
+        if (!list.empty()) {
+            list += ',';
+        }
+        list += std::to_string(cpus[i]);
+        if (j > i) {
+            list += '-' + std::to_string(cpus[j]);
+        }
+        i = j + 1;
+    }
+    return list;
+}
+
+std::vector<int> CpuTopology::allowedCpus()
+{
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    return cpus;
+}
+
+std::vector<CpuTopology::NumaNode> CpuTopology::numaNodes()
+{
+    std::vector<NumaNode> nodes;
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string list;
+    if (!std::getline(online, list)) {
+        return nodes;
+    }
+
+    for (int id : parseCpuList(list)) {
+        std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+        std::string cpus;
+        if (std::getline(cpulist, cpus)) {
+            nodes.push_back(NumaNode{id, parseCpuList(cpus)});
+        }
+    }
+    return nodes;
+}
+
+bool CpuTopology::pinCurrentThread(const std::vector<int> &cpus)
+{
+#ifdef __linux__
+    if (cpus.empty()) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+std::vector<std::vector<int>> CpuTopology::partition(const std::vector<int> &cpus, int parts)
+{
+    std::vector<std::vector<int>> slices;
+    if (cpus.empty() || parts <= 0) {
+        return slices;
+    }
+
+    const std::size_t count = cpus.size();
+    const std::size_t partCount = static_cast<std::size_t>(parts);
+    for (std::size_t i = 0; i < partCount; ++i) {
+        if (partCount >= count) {
+            slices.push_back({cpus[i % count]});
+        } else {
+            // 各段 CPU 数最多相差一个
+            std::size_t begin = i * count / partCount;
+            std::size_t end = (i + 1) * count / partCount;
+            slices.emplace_back(cpus.begin() + begin, cpus.begin() + end);
+        }
+    }
+    return slices;
+}
+
+std::string CpuTopology::setIntraOpThreads(int threads)
+{
+    threads = std::max(1, threads);
+    std::string applied = "OpenCV";
+    cv::setNumThreads(threads);
+
+    if (openblas_set_num_threads) {
+        openblas_set_num_threads(threads);
+        applied += ",OpenBLAS";
+    }
+    if (MKL_Set_Num_Threads) {
+        MKL_Set_Num_Threads(threads);
+        applied += ",MKL";
+    }
+
+    // 之后才惰性加载的库仍按环境变量初始化
+    const std::string value = std::to_string(threads);
+    setenv("OPENBLAS_NUM_THREADS", value.c_str(), 1);
+    setenv("MKL_NUM_THREADS", value.c_str(), 1);
+    setenv("OMP_NUM_THREADS", value.c_str(), 1);
+    return applied;
+}
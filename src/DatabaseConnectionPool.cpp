@@ -0,0 +1,261 @@
+#include "DatabaseConnectionPool.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace {
+
+// 空闲超过该时间的连接在借出前先检查是否仍然可用（MySQL 会断开 wait_timeout 内没有活动的连接）
+const qint64 HEALTH_CHECK_IDLE_MS = 30 * 1000;
+
+// 连接数达到上限时，新线程等待其他线程退出（释放连接）的最长时间
+const unsigned long ACQUIRE_TIMEOUT_MS = 5000;
+
+// 每个线程一个不会复用的序号（线程 id 在线程退出后可能被新线程复用）
+quint64 currentThreadKey()
+{
+    static std::atomic<quint64> nextThreadKey{1};
+    thread_local const quint64 threadKey = nextThreadKey++;
+    return threadKey;
+}
+
+} // namespace
+
+// 每个线程一份：记录该线程在哪些池中建立过连接，线程退出时在本线程内关闭它们
+struct ThreadConnections
+{
+    std::vector<std::weak_ptr<DatabaseConnectionPool::Registration>> pools;
+
+    ~ThreadConnections()
+    {
+        const quint64 threadKey = currentThreadKey();
+        for (const auto &weak : pools) {
+            if (auto registration = weak.lock()) {
+                // 持有 registration->mutex 期间池不会析构
+                QMutexLocker locker(&registration->mutex);
+                if (registration->pool != nullptr) {
+                    registration->pool->closeThreadConnection(threadKey);
+                }
+            }
+        }
+    }
+
+    void add(const std::shared_ptr<DatabaseConnectionPool::Registration> &registration)
+    {
+        for (const auto &weak : pools) {
+            if (!weak.owner_before(registration) && !registration.owner_before(weak)) {
+                return;
+            }
+        }
+        pools.push_back(registration);
+    }
+};
+
+namespace {
+
+ThreadConnections &threadConnections()
+{
+    thread_local ThreadConnections connections;
+    return connections;
+}
+
+} // namespace
+
+DatabaseConnectionPool::Lease::Lease(DatabaseConnectionPool *pool, Connection *connection)
+    : m_pool(pool), m_connection(connection)
+{
+}
+
+DatabaseConnectionPool::Lease::Lease(Lease &&other) noexcept
+    : m_pool(other.m_pool), m_connection(other.m_connection)
+{
+    other.m_pool = nullptr;
+    other.m_connection = nullptr;
+}
+
+DatabaseConnectionPool::Lease::~Lease()
+{
+    if (m_pool && m_connection) {
+        m_pool->release(m_connection);
+    }
+}
+
+QSqlDatabase DatabaseConnectionPool::Lease::database() const
+{
+    return m_connection ? m_connection->db : QSqlDatabase();
+}
+
+DatabaseConnectionPool::DatabaseConnectionPool()
+    : m_port(0), m_maxSize(32), m_nextConnectionId(0),
+      m_registration(std::make_shared<Registration>())
+{
+    m_registration->pool = this;
+    m_clock.start();
+}
+
+DatabaseConnectionPool::~DatabaseConnectionPool()
+{
+    {
+        QMutexLocker registrationLocker(&m_registration->mutex);
+        m_registration->pool = nullptr;
+    }
+
+    // 工作线程此时都已退出并关闭了各自的连接，剩下的通常只有析构所在线程自己的连接
+    ConnectionMap remaining;
+    {
+        QMutexLocker locker(&m_mutex);
+        remaining.swap(m_connections);
+    }
+    for (auto &entry : remaining) {
+        const QString name = entry.second->name;
+        entry.second->db.close();
+        entry.second->db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(name);
+    }
+}
+
+void DatabaseConnectionPool::setDatabase(const QString &driver, const QString &host, int port, const QString &dbName,
+                                         const QString &user, const QString &password)
+{
+    QMutexLocker locker(&m_mutex);
+    m_driver = driver;
+    m_host = host;
+    m_port = port;
+    m_dbName = dbName;
+    m_user = user;
+    m_password = password;
+}
+
+void DatabaseConnectionPool::setMaxSize(int maxSize)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxSize = std::max(1, maxSize);
+}
+
+DatabaseConnectionPool::Lease DatabaseConnectionPool::acquire()
+{
+    const quint64 threadKey = currentThreadKey();
+
+    QMutexLocker locker(&m_mutex);
+    auto it = m_connections.find(threadKey);
+    if (it != m_connections.end()) {
+        Connection *connection = it->second.get();
+        if (connection->inUse > 0) {
+            ++connection->inUse;
+            return Lease(this, connection);  // 同一线程嵌套借出
+        }
+
+        // 连接只由本线程关闭，检查和重连放到锁外
+        ++connection->inUse;
+        const bool idleLong = m_clock.elapsed() - connection->lastUsed > HEALTH_CHECK_IDLE_MS;
+        locker.unlock();
+        if ((idleLong || !connection->db.isOpen()) && !ping(connection)) {
+            qWarning() << "数据库连接" << connection->name << "已失效，重新连接";
+            connection->db.close();
+            open(connection);
+        }
+        return Lease(this, connection);
+    }
+
+    // 新线程：连接数达到上限时等待其他线程退出（连接只能由所属线程关闭）
+    QElapsedTimer waitTimer;
+    waitTimer.start();
+    while (static_cast<int>(m_connections.size()) >= m_maxSize) {
+        qint64 remaining = static_cast<qint64>(ACQUIRE_TIMEOUT_MS) - waitTimer.elapsed();
+        if (remaining <= 0 || !m_closed.wait(&m_mutex, static_cast<unsigned long>(remaining))) {
+            qWarning() << "数据库连接池已满(" << m_maxSize << "个连接均属于仍在运行的线程)，获取连接超时";
+            return Lease(nullptr, nullptr);
+        }
+    }
+
+    std::unique_ptr<Connection> created(new Connection);
+    created->name = QString("face_db_%1").arg(++m_nextConnectionId);
+    created->db = QSqlDatabase::addDatabase(m_driver, created->name);
+    created->db.setHostName(m_host);
+    created->db.setPort(m_port);
+    created->db.setDatabaseName(m_dbName);
+    created->db.setUserName(m_user);
+    created->db.setPassword(m_password);
+    created->inUse = 1;
+    Connection *connection = created.get();
+    m_connections.emplace(threadKey, std::move(created));
+    threadConnections().add(m_registration);
+
+    // 建立连接需要网络往返，不持锁进行
+    locker.unlock();
+    if (!open(connection)) {
+        discard(threadKey, connection);
+        return Lease(nullptr, nullptr);
+    }
+    return Lease(this, connection);
+}
+
+int DatabaseConnectionPool::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return static_cast<int>(m_connections.size());
+}
+
+int DatabaseConnectionPool::inUseCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return static_cast<int>(std::count_if(m_connections.begin(), m_connections.end(),
+                                          [](const ConnectionMap::value_type &entry) { return entry.second->inUse > 0; }));
+}
+
+void DatabaseConnectionPool::release(Connection *connection)
+{
+    QMutexLocker locker(&m_mutex);
+    if (--connection->inUse == 0) {
+        connection->lastUsed = m_clock.elapsed();
+    }
+}
+
+bool DatabaseConnectionPool::open(Connection *connection)
+{
+    if (!connection->db.open()) {
+        qWarning() << "数据库连接" << connection->name << "建立失败:" << connection->db.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseConnectionPool::ping(Connection *connection)
+{
+    QSqlQuery query(connection->db);
+    return connection->db.isOpen() && query.exec("SELECT 1");
+}
+
+void DatabaseConnectionPool::discard(quint64 threadKey, Connection *connection)
+{
+    // 只在连接所属线程中调用，不持有 m_mutex：QMYSQL 关闭连接会清理调用线程的客户端状态，也可能有网络往返；
+    // removeDatabase 前先释放持有的 QSqlDatabase 句柄，否则 Qt 会提示连接仍在使用
+    const QString name = connection->name;
+    connection->db.close();
+    connection->db = QSqlDatabase();
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_connections.erase(threadKey);
+        m_closed.wakeAll();
+    }
+    QSqlDatabase::removeDatabase(name);
+}
+
+void DatabaseConnectionPool::closeThreadConnection(quint64 threadKey)
+{
+    Connection *connection = nullptr;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_connections.find(threadKey);
+        if (it == m_connections.end() || it->second->inUse > 0) {
+            return;
+        }
+        connection = it->second.get();
+    }
+    discard(threadKey, connection);
+}
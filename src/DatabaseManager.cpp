@@ -1,48 +1,68 @@
 #include "DatabaseManager.h"
+#include "DescriptorBlob.h"
 #include <QDebug>
-#include <QDataStream>
 #include <QDateTime>
+#include <QThread>
 
-DatabaseManager::DatabaseManager(QObject *parent) : QObject(parent)
+DatabaseManager::DatabaseManager(QObject *parent)
+    : QObject(parent), m_authCache(new UserAuthCache(64LL * 1024 * 1024, 300)),
+      m_lastLoginFlushQueued(false), m_lastLoginFlushMs(1000), m_lastLoginBatchSize(200)
 {
 }
 
 DatabaseManager::~DatabaseManager()
 {
-    if (m_db.isOpen()) {
-        m_db.close();
-    }
+    flushLastLogins();
+}
+
+void DatabaseManager::setLastLoginOptions(int flushIntervalMs, int batchSize)
+{
+    m_lastLoginFlushMs = qMax(0, flushIntervalMs);
+    m_lastLoginBatchSize = qMax(1, batchSize);
+}
+
+void DatabaseManager::setPoolOptions(int maxSize)
+{
+    m_pool.setMaxSize(maxSize);
+}
+
+void DatabaseManager::setAuthCacheOptions(qint64 capacityBytes, int ttlSeconds)
+{
+    m_authCache.reset(new UserAuthCache(capacityBytes, ttlSeconds));
 }
 
 bool DatabaseManager::initialize(const QString &host, int port, const QString &dbName,
                                 const QString &user, const QString &password)
 {
-    // 向 QSqlDatabase 类添加一个新的数据库连接
-    m_db = QSqlDatabase::addDatabase("QMYSQL");  // "QMYSQL" 是指 MySQL 数据库的驱动程序
-    m_db.setHostName(host);
-    m_db.setPort(port);
-    m_db.setDatabaseName(dbName);
-    m_db.setUserName(user);
-    m_db.setPassword(password);
-
-    if (!m_db.open()) {
-        qCritical() << "❌ 数据库连接失败:" << m_db.lastError().text();
+    // 每个工作线程在第一次查询时建立自己的连接，这里先在当前线程建立一个，确认连接参数可用
+    m_pool.setDatabase("QMYSQL", host, port, dbName, user, password);  // "QMYSQL" 是指 MySQL 数据库的驱动程序
+    DatabaseConnectionPool::Lease connection = m_pool.acquire();
+    if (!connection.isValid()) {
+        qCritical() << "❌ 数据库连接失败";
         return false;
     }
 
-    qInfo() << "✅ 数据库连接成功";
+    qInfo() << "✅ 数据库连接成功，连接池上限" << m_pool.maxSize() << "个连接";
+
+    // 定期写入缓冲的最近登录时间
+    if (m_lastLoginFlushMs > 0) {
+        connect(&m_lastLoginTimer, &QTimer::timeout, this, &DatabaseManager::flushLastLogins);
+        m_lastLoginTimer.start(m_lastLoginFlushMs);
+    }
+
     return createTables();
 }
 
 bool DatabaseManager::createTables()
 {
-    QSqlQuery query(m_db);
+    DatabaseConnectionPool::Lease connection = m_pool.acquire();
+    QSqlQuery query(connection.database());
     
     QString createTableSQL = R"(
         CREATE TABLE IF NOT EXISTS users (
             id INT AUTO_INCREMENT PRIMARY KEY,
             username VARCHAR(128) UNIQUE NOT NULL,
-            face_descriptor LONGBLOB DEFAULT NULL COMMENT '128维人脸特征向量',
+            face_descriptor LONGBLOB DEFAULT NULL COMMENT '人脸特征模板集(128维特征,或质心+多个模板)',
             password_hash VARCHAR(64) DEFAULT NULL COMMENT '密码SHA256哈希',
             created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
             last_login TIMESTAMP NULL DEFAULT NULL,
@@ -61,55 +81,156 @@ bool DatabaseManager::createTables()
 
 QByteArray DatabaseManager::descriptorToBlob(const QVector<float> &descriptor)
 {
-    QByteArray byteArray;
-    QDataStream stream(&byteArray, QIODevice::WriteOnly);
-    stream.setVersion(QDataStream::Qt_5_12);
-    stream << descriptor;
-    return byteArray;
+    QByteArray blob(descriptor.size() * static_cast<int>(sizeof(float)), Qt::Uninitialized);
+    DescriptorBlob::encode(descriptor.constData(), static_cast<size_t>(descriptor.size()), blob.data());
+    return blob;
 }
 
 QVector<float> DatabaseManager::blobToDescriptor(const QByteArray &blob)
 {
-    QVector<float> descriptor;
-    QDataStream stream(blob);
-    stream.setVersion(QDataStream::Qt_5_12);
-    stream >> descriptor;
+    // 格式说明见 DescriptorBlob；原始格式一次 memcpy 直接填入 QVector 的缓冲区
+    const size_t size = static_cast<size_t>(blob.size());
+    QVector<float> descriptor(static_cast<int>(DescriptorBlob::elementCount(blob.constData(), size)));
+    if (!DescriptorBlob::decode(blob.constData(), size, descriptor.data())) {
+        qWarning() << "无法识别的人脸特征格式，长度" << blob.size();
+        return {};
+    }
     return descriptor;
 }
 
-bool DatabaseManager::userExists(const QString &username)
+int DatabaseManager::migrateLegacyDescriptors(int batchSize, const std::atomic<bool> &stop)
 {
-    QSqlQuery query(m_db);
-    query.prepare("SELECT COUNT(*) FROM users WHERE username = :username");
+    batchSize = qMax(1, batchSize);
+    int migrated = 0;
+    int lastId = 0;
+
+    DatabaseConnectionPool::Lease connection = m_pool.acquire();
+    QSqlDatabase database = connection.database();
+
+    while (!stop) {
+        // 按主键分批扫描长度模 512 余 4 的旧格式记录
+        QVector<QPair<int, QByteArray>> batch;
+        {
+            QSqlQuery query(database);
+            query.setForwardOnly(true);
+            query.prepare("SELECT id, face_descriptor FROM users "
+                          "WHERE id > :lastId AND face_descriptor IS NOT NULL "
+                          "AND MOD(LENGTH(face_descriptor), 512) = 4 "
+                          "ORDER BY id LIMIT :limit");
+            query.bindValue(":lastId", lastId);
+            query.bindValue(":limit", batchSize);
+            if (!query.exec()) {
+                qWarning() << "查询旧格式人脸特征失败:" << query.lastError().text();
+                break;
+            }
+            while (query.next()) {
+                batch.append(qMakePair(query.value(0).toInt(), query.value(1).toByteArray()));
+            }
+        }
+        if (batch.isEmpty()) {
+            break;
+        }
+        lastId = batch.last().first;
+
+        // 每批一个事务；UPDATE 带上旧值作为条件，期间被用户更新过的记录保持新值不动
+        database.transaction();
+        QSqlQuery update(database);
+        update.prepare("UPDATE users SET face_descriptor = :raw WHERE id = :id AND face_descriptor = :legacy");
+        int updated = 0;
+        for (const auto &row : batch) {
+            QVector<float> descriptor = blobToDescriptor(row.second);
+            if (descriptor.isEmpty() || descriptor.size() % DescriptorBlob::DIMENSION != 0) {
+                continue;
+            }
+            update.bindValue(":raw", descriptorToBlob(descriptor));
+            update.bindValue(":id", row.first);
+            update.bindValue(":legacy", row.second);
+            if (!update.exec()) {
+                qWarning() << "改写人脸特征失败 id" << row.first << ":" << update.lastError().text();
+                continue;
+            }
+            updated += update.numRowsAffected() > 0 ? 1 : 0;
+        }
+        if (!database.commit()) {
+            qWarning() << "提交人脸特征改写失败:" << database.lastError().text();
+            database.rollback();
+            break;
+        }
+        migrated += updated;
+
+        // 批次之间让出数据库，避免影响在线请求
+        QThread::msleep(50);
+    }
+
+    return migrated;
+}
+
+UserAuthRecord DatabaseManager::getAuthRecord(const QString &username)
+{
+    UserAuthRecord record;
+    quint64 generation = 0;
+    if (m_authCache->lookup(username, record, generation)) {
+        return record;
+    }
+
+    DatabaseConnectionPool::Lease connection = m_pool.acquire();
+    QSqlQuery query(connection.database());
+    query.prepare("SELECT username, password_hash, face_descriptor FROM users WHERE username = :username");
     query.bindValue(":username", username);
 
     if (!query.exec()) {
         qWarning() << "查询用户失败:" << query.lastError().text();
-        return false;
+        return record;  // 查询失败不缓存
     }
 
     if (query.next()) {
-        return query.value(0).toInt() > 0;
+        record.exists = true;
+        record.passwordHash = query.value(1).toString();
+        QByteArray blob = query.value(2).toByteArray();
+        if (!blob.isEmpty()) {
+            record.descriptor = blobToDescriptor(blob);
+        }
+
+        // 写入方按库中保存的用户名失效缓存；重音、全角等写法与之缓存键不同时不缓存，每次查库
+        if (!UserAuthCache::sameKey(username, query.value(0).toString())) {
+            return record;
+        }
     }
-    return false;
+
+    m_authCache->insert(username, record, generation);
+    return record;
 }
 
-// 插入人脸特征和密码哈希
-bool DatabaseManager::insertUser(const QString &username, const QVector<float> &faceDescriptor, 
-                                const QString &passwordHash)
+bool DatabaseManager::findUserRow(QSqlDatabase db, const QString &username, int &id, QString &storedName)
 {
-    if (userExists(username)) {
-        qWarning() << "用户已存在:" << username;
+    QSqlQuery query(db);
+    query.prepare("SELECT id, username FROM users WHERE username = :username");
+    query.bindValue(":username", username);
+    if (!query.exec() || !query.next()) {
         return false;
     }
+    id = query.value(0).toInt();
+    storedName = query.value(1).toString();
+    return true;
+}
 
+bool DatabaseManager::userExists(const QString &username)
+{
+    return getAuthRecord(username).exists;
+}
+
+// 插入人脸特征和密码哈希
+bool DatabaseManager::insertUser(const QString &username, const QVector<float> &faceDescriptor, 
+                                const QString &passwordHash)
+{
     // 检查至少提供一种认证方式
     if (faceDescriptor.isEmpty() && passwordHash.isEmpty()) {
         qWarning() << "必须提供人脸特征或密码";
         return false;
     }
 
-    QSqlQuery query(m_db);
+    DatabaseConnectionPool::Lease connection = m_pool.acquire();
+    QSqlQuery query(connection.database());
     
     // 根据提供的数据动态构建 SQL
     QString sql;
@@ -137,62 +258,62 @@ bool DatabaseManager::insertUser(const QString &username, const QVector<float> &
         query.bindValue(":password", passwordHash);
     }
 
+    // 用户名唯一索引保证不会重复插入，不再预先查询用户是否存在
     if (!query.exec()) {
-        qCritical() << "插入用户失败:" << query.lastError().text();
+        if (query.lastError().nativeErrorCode() == "1062") {  // ER_DUP_ENTRY
+            qWarning() << "用户已存在:" << username;
+        } else {
+            qCritical() << "插入用户失败:" << query.lastError().text();
+        }
         return false;
     }
+    m_authCache->invalidate(username);
 
     qInfo() << "✅ 用户注册成功:" << username 
             << (faceDescriptor.isEmpty() ? "" : "[人脸]")
             << (passwordHash.isEmpty() ? "" : "[密码]");
+
+    if (!faceDescriptor.isEmpty()) {
+        emit userDescriptorChanged(username, faceDescriptor);
+    }
     return true;
 }
 
 QVector<float> DatabaseManager::getUserDescriptor(const QString &username)
 {
-    QSqlQuery query(m_db);
-    query.prepare("SELECT face_descriptor FROM users WHERE username = :username");
-    query.bindValue(":username", username);
-
-    if (!query.exec()) {
-        qWarning() << "查询失败:" << query.lastError().text();
-        return {};
-    }
-
-    if (query.next()) {
-        QByteArray blob = query.value(0).toByteArray();
-        if (blob.isEmpty()) {
-            return {};  // 用户没有录入人脸
-        }
-        return blobToDescriptor(blob);
-    }
-
-    return {};
+    return getAuthRecord(username).descriptor;  // 用户没有录入人脸时为空
 }
 
 QString DatabaseManager::getUserPassword(const QString &username)
 {
-    QSqlQuery query(m_db);
-    query.prepare("SELECT password_hash FROM users WHERE username = :username");
-    query.bindValue(":username", username);
-
-    if (!query.exec()) {
-        qWarning() << "查询密码失败:" << query.lastError().text();
-        return QString();
-    }
-
-    if (query.next()) {
-        return query.value(0).toString();
-    }
-
-    return QString();
+    return getAuthRecord(username).passwordHash;
 }
 
 bool DatabaseManager::updateLastLogin(const QString &username)
 {
-    QSqlQuery query(m_db);
+    const QDateTime now = QDateTime::currentDateTime();
+
+    if (m_lastLoginFlushMs > 0) {
+        // 登录请求只写内存；积累到一批时让 DatabaseManager 所在线程立即写入，不占用当前请求的时间
+        bool flushNow = false;
+        {
+            QMutexLocker locker(&m_lastLoginMutex);
+            m_pendingLogins.insert(username, now);
+            if (m_pendingLogins.size() >= m_lastLoginBatchSize && !m_lastLoginFlushQueued) {
+                m_lastLoginFlushQueued = true;
+                flushNow = true;
+            }
+        }
+        if (flushNow) {
+            QMetaObject::invokeMethod(this, [this]() { flushLastLogins(); }, Qt::QueuedConnection);
+        }
+        return true;
+    }
+
+    DatabaseConnectionPool::Lease connection = m_pool.acquire();
+    QSqlQuery query(connection.database());
     query.prepare("UPDATE users SET last_login = :time WHERE username = :username");
-    query.bindValue(":time", QDateTime::currentDateTime());
+    query.bindValue(":time", now);
     query.bindValue(":username", username);
 
     if (!query.exec()) {
@@ -203,41 +324,121 @@ bool DatabaseManager::updateLastLogin(const QString &username)
     return true;
 }
 
+void DatabaseManager::flushLastLogins()
+{
+    QHash<QString, QDateTime> pending;
+    {
+        QMutexLocker locker(&m_lastLoginMutex);
+        pending.swap(m_pendingLogins);
+        m_lastLoginFlushQueued = false;
+    }
+    if (pending.isEmpty()) {
+        return;
+    }
+
+    DatabaseConnectionPool::Lease connection = m_pool.acquire();
+    QVector<QPair<QString, QDateTime>> failed;
+
+    // 每批一条语句: UPDATE users SET last_login = CASE username WHEN ? THEN ? ... END WHERE username IN (?, ...)
+    auto it = pending.constBegin();
+    while (it != pending.constEnd()) {
+        QVector<QPair<QString, QDateTime>> batch;
+        for (; it != pending.constEnd() && batch.size() < m_lastLoginBatchSize; ++it) {
+            batch.append(qMakePair(it.key(), it.value()));
+        }
+
+        QString sql = "UPDATE users SET last_login = CASE username";
+        for (int i = 0; i < batch.size(); ++i) {
+            sql += " WHEN ? THEN ?";
+        }
+        sql += " ELSE last_login END WHERE username IN (";
+        for (int i = 0; i < batch.size(); ++i) {
+            sql += i == 0 ? "?" : ", ?";
+        }
+        sql += ")";
+
+        QSqlQuery query(connection.database());
+        query.prepare(sql);
+        for (const auto &login : batch) {
+            query.addBindValue(login.first);
+            query.addBindValue(login.second);
+        }
+        for (const auto &login : batch) {
+            query.addBindValue(login.first);
+        }
+
+        if (!query.exec()) {
+            qWarning() << "批量更新登录时间失败:" << query.lastError().text();
+            failed += batch;
+        }
+    }
+
+    // 写入失败的放回缓冲等下次重试；期间同一用户又登录过的保留更新的时间
+    if (!failed.isEmpty()) {
+        QMutexLocker locker(&m_lastLoginMutex);
+        for (const auto &login : failed) {
+            if (!m_pendingLogins.contains(login.first)) {
+                m_pendingLogins.insert(login.first, login.second);
+            }
+        }
+    }
+}
+
 bool DatabaseManager::updateUserPassword(const QString &username, const QString &newPasswordHash)
 {
-    QSqlQuery query(m_db);
-    query.prepare("UPDATE users SET password_hash = :password WHERE username = :username");
+    DatabaseConnectionPool::Lease connection = m_pool.acquire();
+    int id = 0;
+    QString storedName;
+    if (!findUserRow(connection.database(), username, id, storedName)) {
+        qWarning() << "更新密码失败: 用户" << username << "不存在";
+        return false;
+    }
+
+    QSqlQuery query(connection.database());
+    query.prepare("UPDATE users SET password_hash = :password WHERE id = :id");
     query.bindValue(":password", newPasswordHash);
-    query.bindValue(":username", username);
+    query.bindValue(":id", id);
 
     if (!query.exec()) {
         qWarning() << "更新密码失败:" << query.lastError().text();
         return false;
     }
+    m_authCache->invalidate(storedName);
 
-    qInfo() << "✅ 用户" << username << "密码已更新";
+    qInfo() << "✅ 用户" << storedName << "密码已更新";
     return true;
 }
 
 bool DatabaseManager::updateUserDescriptor(const QString &username, const QVector<float> &newDescriptor)
 {
-    QSqlQuery query(m_db);
-    query.prepare("UPDATE users SET face_descriptor = :descriptor WHERE username = :username");
+    DatabaseConnectionPool::Lease connection = m_pool.acquire();
+    int id = 0;
+    QString storedName;
+    if (!findUserRow(connection.database(), username, id, storedName)) {
+        qWarning() << "更新人脸特征失败: 用户" << username << "不存在";
+        return false;
+    }
+
+    QSqlQuery query(connection.database());
+    query.prepare("UPDATE users SET face_descriptor = :descriptor WHERE id = :id");
     query.bindValue(":descriptor", descriptorToBlob(newDescriptor));
-    query.bindValue(":username", username);
+    query.bindValue(":id", id);
 
     if (!query.exec()) {
         qWarning() << "更新人脸特征失败:" << query.lastError().text();
         return false;
     }
+    m_authCache->invalidate(storedName);
 
-    qInfo() << "✅ 用户" << username << "人脸特征已更新";
+    qInfo() << "✅ 用户" << storedName << "人脸特征已更新";
+    emit userDescriptorChanged(storedName, newDescriptor);
     return true;
 }
 
 QVariantMap DatabaseManager::getUserInfo(const QString &username)
 {
-    QSqlQuery query(m_db);
+    DatabaseConnectionPool::Lease connection = m_pool.acquire();
+    QSqlQuery query(connection.database());
     query.prepare("SELECT id, username, created_at, last_login, "
                  "(face_descriptor IS NOT NULL) as has_face, "
                  "(password_hash IS NOT NULL) as has_password "
@@ -266,10 +467,11 @@ QVariantMap DatabaseManager::getUserInfo(const QString &username)
 QVector<QVariantMap> DatabaseManager::getAllUsers()
 {
     QVector<QVariantMap> users;
+    DatabaseConnectionPool::Lease connection = m_pool.acquire();
     QSqlQuery query("SELECT username, created_at, last_login, "
                    "(face_descriptor IS NOT NULL) as has_face, "
                    "(password_hash IS NOT NULL) as has_password "
-                   "FROM users ORDER BY created_at DESC", m_db);
+                   "FROM users ORDER BY created_at DESC", connection.database());
 
     while (query.next()) {
         QVariantMap user;
@@ -284,24 +486,61 @@ QVector<QVariantMap> DatabaseManager::getAllUsers()
     return users;
 }
 
+QVector<QPair<QString, QVector<float>>> DatabaseManager::getAllDescriptors()
+{
+    QVector<QPair<QString, QVector<float>>> descriptors;
+    DatabaseConnectionPool::Lease connection = m_pool.acquire();
+    QSqlQuery query(connection.database());
+    query.setForwardOnly(true);
+
+    if (!query.exec("SELECT username, face_descriptor FROM users "
+                    "WHERE face_descriptor IS NOT NULL ORDER BY id")) {
+        qWarning() << "查询人脸特征失败:" << query.lastError().text();
+        return descriptors;
+    }
+
+    while (query.next()) {
+        QByteArray blob = query.value(1).toByteArray();
+        if (blob.isEmpty()) {
+            continue;
+        }
+        descriptors.append(qMakePair(query.value(0).toString(), blobToDescriptor(blob)));
+    }
+
+    return descriptors;
+}
+
 bool DatabaseManager::deleteUser(const QString &username)
 {
-    QSqlQuery query(m_db);
-    query.prepare("DELETE FROM users WHERE username = :username");
-    query.bindValue(":username", username);
+    DatabaseConnectionPool::Lease connection = m_pool.acquire();
+    int id = 0;
+    QString storedName;
+    if (!findUserRow(connection.database(), username, id, storedName)) {
+        qWarning() << "删除用户失败: 用户" << username << "不存在";
+        return false;
+    }
+
+    QSqlQuery query(connection.database());
+    query.prepare("DELETE FROM users WHERE id = :id");
+    query.bindValue(":id", id);
     
     if (!query.exec()) {
         qWarning() << "删除用户失败:" << query.lastError().text();
         return false;
     }
+    m_authCache->invalidate(storedName);
 
-    qInfo() << "✅ 用户" << username << "已删除";
+    qInfo() << "✅ 用户" << storedName << "已删除";
+    if (query.numRowsAffected() > 0) {
+        emit userRemoved(storedName);
+    }
     return true;
 }
 
 int DatabaseManager::getUserCount()
 {
-    QSqlQuery query("SELECT COUNT(*) FROM users", m_db);
+    DatabaseConnectionPool::Lease connection = m_pool.acquire();
+    QSqlQuery query("SELECT COUNT(*) FROM users", connection.database());
     
     if (query.next()) {
         return query.value(0).toInt();
@@ -0,0 +1,105 @@
+#include "DescriptorBlob.h"
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+const std::size_t LEGACY_HEADER_BYTES = 4;
+const std::size_t LEGACY_ELEMENT_BYTES = 8;
+
+bool hostIsLittleEndian()
+{
+    const std::uint16_t probe = 1;
+    unsigned char firstByte;
+    std::memcpy(&firstByte, &probe, 1);
+    return firstByte == 1;
+}
+
+std::uint32_t readBigEndian32(const char *data)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+    return (std::uint32_t(bytes[0]) << 24) | (std::uint32_t(bytes[1]) << 16)
+           | (std::uint32_t(bytes[2]) << 8) | std::uint32_t(bytes[3]);
+}
+
+std::uint64_t readBigEndian64(const char *data)
+{
+    return (std::uint64_t(readBigEndian32(data)) << 32) | readBigEndian32(data + 4);
+}
+
+std::uint32_t byteSwap32(std::uint32_t value)
+{
+    return (value >> 24) | ((value >> 8) & 0xFF00u) | ((value << 8) & 0xFF0000u) | (value << 24);
+}
+
+} // namespace
+
+DescriptorBlob::Format DescriptorBlob::detect(const char *data, std::size_t size)
+{
+    if (size % RAW_DESCRIPTOR_BYTES == 0) {
+        return Format::Raw;
+    }
+    if (size % RAW_DESCRIPTOR_BYTES == LEGACY_HEADER_BYTES
+        && readBigEndian32(data) == (size - LEGACY_HEADER_BYTES) / LEGACY_ELEMENT_BYTES) {
+        return Format::Legacy;
+    }
+    return Format::Unknown;
+}
+
+std::size_t DescriptorBlob::elementCount(const char *data, std::size_t size)
+{
+    switch (detect(data, size)) {
+    case Format::Raw:
+        return size / sizeof(float);
+    case Format::Legacy:
+        return (size - LEGACY_HEADER_BYTES) / LEGACY_ELEMENT_BYTES;
+    default:
+        return 0;
+    }
+}
+
+void DescriptorBlob::encode(const float *values, std::size_t count, char *out)
+{
+    if (hostIsLittleEndian()) {
+        std::memcpy(out, values, count * sizeof(float));
+        return;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        std::uint32_t bits;
+        std::memcpy(&bits, values + i, sizeof(bits));
+        bits = byteSwap32(bits);
+        std::memcpy(out + i * sizeof(float), &bits, sizeof(bits));
+    }
+}
+
+bool DescriptorBlob::decode(const char *data, std::size_t size, float *out)
+{
+    switch (detect(data, size)) {
+    case Format::Raw:
+        // 原始格式与编码对称：小端主机上一次 memcpy
+        if (hostIsLittleEndian()) {
+            std::memcpy(out, data, size);
+        } else {
+            for (std::size_t i = 0; i < size / sizeof(float); ++i) {
+                std::uint32_t bits;
+                std::memcpy(&bits, data + i * sizeof(float), sizeof(bits));
+                bits = byteSwap32(bits);
+                std::memcpy(out + i, &bits, sizeof(bits));
+            }
+        }
+        return true;
+    case Format::Legacy: {
+        // 与 QDataStream（Qt_5_12，双精度）读取 float 相同：大端 double 转回 float
+        const std::size_t count = (size - LEGACY_HEADER_BYTES) / LEGACY_ELEMENT_BYTES;
+        for (std::size_t i = 0; i < count; ++i) {
+            std::uint64_t bits = readBigEndian64(data + LEGACY_HEADER_BYTES + i * LEGACY_ELEMENT_BYTES);
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            out[i] = static_cast<float>(value);
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,338 @@
+#include "DistanceKernels.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FACE_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+#ifndef FACE_KERNELS_X86
+
+float squaredL2Scalar(const float *a, const float *b, int dim)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < dim; ++i) {
+        float diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+void squaredL2BatchScalar(const float *query, const float *rows, std::size_t count, int dim, float *out)
+{
+    for (std::size_t row = 0; row < count; ++row) {
+        out[row] = squaredL2Scalar(query, rows + row * dim, dim);
+    }
+}
+
+#endif // !FACE_KERNELS_X86
+
+float squaredL2Int8Scalar(const float *query, const std::int8_t *codes, const float *scales, int dim)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < dim; ++i) {
+        float diff = query[i] - scales[i] * static_cast<float>(codes[i]);
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+#ifndef FACE_KERNELS_X86
+
+void squaredL2Int8BatchScalar(const float *query, const std::int8_t *codes, const float *scales,
+                              std::size_t count, int dim, float *out)
+{
+    for (std::size_t row = 0; row < count; ++row) {
+        out[row] = squaredL2Int8Scalar(query, codes + row * dim, scales, dim);
+    }
+}
+
+#else
+
+// ---------- SSE（x86-64 基线，总是可用） ----------
+
+inline float squaredL2Sse(const float *a, const float *b, int dim)
+{
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= dim; i += 8) {
+        __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        __m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4));
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(d0, d0));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(d1, d1));
+    }
+    for (; i + 4 <= dim; i += 4) {
+        __m128 d = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(d, d));
+    }
+
+    __m128 acc = _mm_add_ps(acc0, acc1);
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 0x55));
+    float sum = _mm_cvtss_f32(acc);
+
+    for (; i < dim; ++i) {
+        float diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+void squaredL2BatchSse(const float *query, const float *rows, std::size_t count, int dim, float *out)
+{
+    for (std::size_t row = 0; row < count; ++row) {
+        out[row] = squaredL2Sse(query, rows + row * dim, dim);
+    }
+}
+
+void squaredL2Int8BatchSse(const float *query, const std::int8_t *codes, const float *scales,
+                           std::size_t count, int dim, float *out)
+{
+    for (std::size_t row = 0; row < count; ++row) {
+        const std::int8_t *code = codes + row * dim;
+        __m128 acc = _mm_setzero_ps();
+        int i = 0;
+        for (; i + 4 <= dim; i += 4) {
+            // SSE2 没有 cvtepi8：把字节复制到 32 位的高 8 位再算术右移完成符号扩展
+            int packed = 0;
+            __builtin_memcpy(&packed, code + i, 4);
+            __m128i bytes = _mm_cvtsi32_si128(packed);
+            bytes = _mm_unpacklo_epi8(bytes, bytes);
+            bytes = _mm_unpacklo_epi16(bytes, bytes);
+            __m128 x = _mm_cvtepi32_ps(_mm_srai_epi32(bytes, 24));
+            __m128 d = _mm_sub_ps(_mm_loadu_ps(query + i), _mm_mul_ps(_mm_loadu_ps(scales + i), x));
+            acc = _mm_add_ps(acc, _mm_mul_ps(d, d));
+        }
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 0x55));
+        out[row] = _mm_cvtss_f32(acc) + squaredL2Int8Scalar(query + i, code + i, scales + i, dim - i);
+    }
+}
+
+// ---------- AVX2 + FMA ----------
+
+__attribute__((target("avx2,fma")))
+inline float squaredL2Avx2(const float *a, const float *b, int dim)
+{
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= dim; i += 16) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+    }
+    for (; i + 8 <= dim; i += 8) {
+        __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        acc0 = _mm256_fmadd_ps(d, d, acc0);
+    }
+
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    __m128 low = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    low = _mm_add_ps(low, _mm_movehl_ps(low, low));
+    low = _mm_add_ss(low, _mm_shuffle_ps(low, low, 0x55));
+    float sum = _mm_cvtss_f32(low);
+
+    for (; i < dim; ++i) {
+        float diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+void squaredL2BatchAvx2(const float *query, const float *rows, std::size_t count, int dim, float *out)
+{
+    for (std::size_t row = 0; row < count; ++row) {
+        // 预取后面第二行，让顺序扫描保持在内存带宽上
+        _mm_prefetch(reinterpret_cast<const char *>(rows + (row + 2) * dim), _MM_HINT_T0);
+        out[row] = squaredL2Avx2(query, rows + row * dim, dim);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+void squaredL2Int8BatchAvx2(const float *query, const std::int8_t *codes, const float *scales,
+                            std::size_t count, int dim, float *out)
+{
+    for (std::size_t row = 0; row < count; ++row) {
+        const std::int8_t *code = codes + row * dim;
+        _mm_prefetch(reinterpret_cast<const char *>(code + 4 * dim), _MM_HINT_T0);
+
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        int i = 0;
+        for (; i + 16 <= dim; i += 16) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(code + i));
+            __m256 x0 = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(bytes));
+            __m256 x1 = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(bytes, 8)));
+            __m256 d0 = _mm256_fnmadd_ps(_mm256_loadu_ps(scales + i), x0, _mm256_loadu_ps(query + i));
+            __m256 d1 = _mm256_fnmadd_ps(_mm256_loadu_ps(scales + i + 8), x1, _mm256_loadu_ps(query + i + 8));
+            acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+            acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+        }
+
+        __m256 acc = _mm256_add_ps(acc0, acc1);
+        __m128 low = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        low = _mm_add_ps(low, _mm_movehl_ps(low, low));
+        low = _mm_add_ss(low, _mm_shuffle_ps(low, low, 0x55));
+        out[row] = _mm_cvtss_f32(low) + squaredL2Int8Scalar(query + i, code + i, scales + i, dim - i);
+    }
+}
+
+// ---------- AVX-512F ----------
+
+__attribute__((target("avx512f")))
+inline float squaredL2Avx512(const float *a, const float *b, int dim)
+{
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    int i = 0;
+    for (; i + 32 <= dim; i += 32) {
+        __m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        __m512 d1 = _mm512_sub_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16));
+        acc0 = _mm512_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm512_fmadd_ps(d1, d1, acc1);
+    }
+    for (; i + 16 <= dim; i += 16) {
+        __m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        acc0 = _mm512_fmadd_ps(d, d, acc0);
+    }
+    if (i < dim) {
+        // 尾部不足 16 个元素时用掩码加载，越界部分按 0 处理
+        __mmask16 mask = static_cast<__mmask16>((1u << (dim - i)) - 1u);
+        __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i));
+        acc1 = _mm512_fmadd_ps(d, d, acc1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+__attribute__((target("avx512f")))
+void squaredL2BatchAvx512(const float *query, const float *rows, std::size_t count, int dim, float *out)
+{
+    for (std::size_t row = 0; row < count; ++row) {
+        _mm_prefetch(reinterpret_cast<const char *>(rows + (row + 2) * dim), _MM_HINT_T0);
+        out[row] = squaredL2Avx512(query, rows + row * dim, dim);
+    }
+}
+
+__attribute__((target("avx512f")))
+void squaredL2Int8BatchAvx512(const float *query, const std::int8_t *codes, const float *scales,
+                              std::size_t count, int dim, float *out)
+{
+    for (std::size_t row = 0; row < count; ++row) {
+        const std::int8_t *code = codes + row * dim;
+        _mm_prefetch(reinterpret_cast<const char *>(code + 4 * dim), _MM_HINT_T0);
+
+        __m512 acc = _mm512_setzero_ps();
+        int i = 0;
+        for (; i + 16 <= dim; i += 16) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(code + i));
+            __m512 x = _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(bytes));
+            __m512 d = _mm512_fnmadd_ps(_mm512_loadu_ps(scales + i), x, _mm512_loadu_ps(query + i));
+            acc = _mm512_fmadd_ps(d, d, acc);
+        }
+        out[row] = _mm512_reduce_add_ps(acc) + squaredL2Int8Scalar(query + i, code + i, scales + i, dim - i);
+    }
+}
+
+float squaredL2Avx2Entry(const float *a, const float *b, int dim) { return squaredL2Avx2(a, b, dim); }
+float squaredL2Avx512Entry(const float *a, const float *b, int dim) { return squaredL2Avx512(a, b, dim); }
+
+#endif // FACE_KERNELS_X86
+
+struct KernelTable
+{
+    float (*pair)(const float *, const float *, int);
+    void (*batch)(const float *, const float *, std::size_t, int, float *);
+    void (*int8Batch)(const float *, const std::int8_t *, const float *, std::size_t, int, float *);
+    const char *name;
+};
+
+KernelTable selectKernels()
+{
+#ifdef FACE_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return {squaredL2Avx512Entry, squaredL2BatchAvx512, squaredL2Int8BatchAvx512, "AVX-512"};
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return {squaredL2Avx2Entry, squaredL2BatchAvx2, squaredL2Int8BatchAvx2, "AVX2+FMA"};
+    }
+    return {squaredL2Sse, squaredL2BatchSse, squaredL2Int8BatchSse, "SSE"};
+#else
+    return {squaredL2Scalar, squaredL2BatchScalar, squaredL2Int8BatchScalar, "scalar"};
+#endif
+}
+
+const KernelTable &kernels()
+{
+    static const KernelTable table = selectKernels();
+    return table;
+}
+
+} // namespace
+
+float DistanceKernels::squaredL2(const float *a, const float *b, int dim)
+{
+    return kernels().pair(a, b, dim);
+}
+
+double DistanceKernels::squaredL2Exact(const float *a, const float *b, int dim)
+{
+    // 不做多路累加：运算顺序固定，编译器在不开启 -ffast-math 时也不会重排
+    double sum = 0.0;
+    for (int i = 0; i < dim; ++i) {
+        double diff = static_cast<double>(a[i]) - static_cast<double>(b[i]);
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+void DistanceKernels::squaredL2Batch(const float *query, const float *rows, std::size_t count, int dim, float *out)
+{
+    kernels().batch(query, rows, count, dim, out);
+}
+
+void DistanceKernels::squaredL2Int8Batch(const float *query, const std::int8_t *codes, const float *scales,
+                                         std::size_t count, int dim, float *out)
+{
+    kernels().int8Batch(query, codes, scales, count, dim, out);
+}
+
+void DistanceKernels::selectTopK(const float *values, std::size_t count, int k,
+                                 std::vector<std::pair<float, std::uint32_t>> &result)
+{
+    result.clear();
+    if (k <= 0 || count == 0) {
+        return;
+    }
+
+    const std::size_t limit = std::min<std::size_t>(static_cast<std::size_t>(k), count);
+    result.reserve(limit);
+
+    // 大小为 k 的最大堆：堆顶是当前第 k 小的值，绝大多数元素只需与堆顶比较一次
+    std::size_t i = 0;
+    for (; i < limit; ++i) {
+        result.emplace_back(values[i], static_cast<std::uint32_t>(i));
+    }
+    std::make_heap(result.begin(), result.end());
+
+    for (; i < count; ++i) {
+        if (values[i] < result.front().first) {
+            std::pop_heap(result.begin(), result.end());
+            result.back() = std::make_pair(values[i], static_cast<std::uint32_t>(i));
+            std::push_heap(result.begin(), result.end());
+        }
+    }
+
+    std::sort_heap(result.begin(), result.end());
+}
+
+const char *DistanceKernels::isaName()
+{
+    return kernels().name;
+}
@@ -0,0 +1,140 @@
+#include "FaceEmbeddingBatcher.h"
+#include "CpuTopology.h"
+#include <QDebug>
+#include <algorithm>
+
+FaceEmbeddingBatcher::FaceEmbeddingBatcher(const anet_type &net, int maxBatchSize, int windowMicros, int workerCount,
+                                           const std::vector<int> &cpus)
+    : m_maxBatchSize(static_cast<size_t>(std::max(1, maxBatchSize))),
+      m_window(std::max(0, windowMicros)),
+      m_stopping(false)
+{
+    workerCount = std::max(1, workerCount);
+    for (int i = 0; i < workerCount; ++i) {
+        m_nets.emplace_back(new anet_type(net));
+    }
+    const std::vector<std::vector<int>> slices = CpuTopology::partition(cpus, workerCount);
+    for (int i = 0; i < workerCount; ++i) {
+        anet_type *netPtr = m_nets[i].get();
+        std::vector<int> workerCpus = slices.empty() ? std::vector<int>() : slices[i];
+        m_workers.emplace_back([this, netPtr, workerCpus]() { run(*netPtr, workerCpus); });
+    }
+
+    qInfo() << "✅ 特征提取微批处理已启动: 批大小" << m_maxBatchSize
+            << "窗口" << m_window.count() << "us, 推理线程" << workerCount;
+    for (size_t i = 0; i < slices.size(); ++i) {
+        qInfo() << "  推理线程" << i << "绑定 CPU" << QString::fromStdString(CpuTopology::formatCpuList(slices[i]));
+    }
+}
+
+FaceEmbeddingBatcher::~FaceEmbeddingBatcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_queueChanged.notify_all();
+
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+}
+
+std::future<dlib::matrix<float, 0, 1>> FaceEmbeddingBatcher::submit(dlib::matrix<dlib::rgb_pixel> &&chip)
+{
+    PendingChip pending;
+    pending.chip = std::move(chip);
+    std::future<dlib::matrix<float, 0, 1>> result = pending.promise.get_future();
+
+    bool batchFull = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(std::move(pending));
+        batchFull = m_queue.size() >= m_maxBatchSize;
+    }
+
+    // 凑满一批时唤醒所有线程，让正在等待窗口的线程立即出发
+    if (batchFull) {
+        m_queueChanged.notify_all();
+    } else {
+        m_queueChanged.notify_one();
+    }
+    return result;
+}
+
+void FaceEmbeddingBatcher::warmUp()
+{
+    // 随机噪声切片，按最大批大小分配，确保之后的任何批次都不会再触发张量扩容
+    dlib::rand rnd;
+    std::vector<dlib::matrix<dlib::rgb_pixel>> chips(m_maxBatchSize);
+    for (auto &chip : chips) {
+        chip.set_size(150, 150);
+        for (long r = 0; r < chip.nr(); ++r) {
+            for (long c = 0; c < chip.nc(); ++c) {
+                chip(r, c) = dlib::rgb_pixel(rnd.get_random_8bit_number(), rnd.get_random_8bit_number(),
+                                             rnd.get_random_8bit_number());
+            }
+        }
+    }
+
+    for (auto &net : m_nets) {
+        (*net)(chips, chips.size());
+    }
+}
+
+void FaceEmbeddingBatcher::run(anet_type &net, const std::vector<int> &cpus)
+{
+    // 绑核后线程不在核间迁移，网络权重和中间张量留在本核（及所在 NUMA 节点）的缓存中
+    if (!cpus.empty() && !CpuTopology::pinCurrentThread(cpus)) {
+        qWarning() << "推理线程绑核失败:" << QString::fromStdString(CpuTopology::formatCpuList(cpus));
+    }
+
+    bool underLoad = false;
+
+    for (;;) {
+        std::vector<PendingChip> batch;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_queueChanged.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                return;  // 已停止且队列清空
+            }
+
+            // 低负载时立即推理，不让单个请求为凑批付出等待；
+            // 上一批不止一个切片说明存在并发，这时才在窗口内继续凑批
+            if (underLoad && m_window.count() > 0 && m_queue.size() < m_maxBatchSize) {
+                m_queueChanged.wait_for(lock, m_window, [this]() {
+                    return m_stopping || m_queue.size() >= m_maxBatchSize;
+                });
+            }
+
+            const size_t count = std::min(m_queue.size(), m_maxBatchSize);
+            batch.reserve(count);
+            for (size_t i = 0; i < count; ++i) {
+                batch.push_back(std::move(m_queue.front()));
+                m_queue.pop_front();
+            }
+        }
+
+        underLoad = batch.size() > 1;
+
+        std::vector<dlib::matrix<dlib::rgb_pixel>> chips;
+        chips.reserve(batch.size());
+        for (auto &pending : batch) {
+            chips.push_back(std::move(pending.chip));
+        }
+
+        try {
+            // 一次前向传播处理整批切片
+            std::vector<dlib::matrix<float, 0, 1>> descriptors = net(chips, chips.size());
+            for (size_t i = 0; i < batch.size(); ++i) {
+                batch[i].promise.set_value(std::move(descriptors[i]));
+            }
+        } catch (...) {
+            std::exception_ptr error = std::current_exception();
+            for (auto &pending : batch) {
+                pending.promise.set_exception(error);
+            }
+        }
+    }
+}
@@ -0,0 +1,534 @@
+#include "FaceGallery.h"
+#include <QDebug>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+const quint32 kIndexFileMagic = 0x58444946;  // "FIDX"
+// 用户名列为 VARCHAR(128)，UTF-8 编码最多 512 字节
+const quint32 kMaxLabelBytes = 512;
+
+// FNV-1a 64 位哈希
+quint64 fnv1a(const void *data, size_t size, quint64 hash = 1469598103934665603ULL)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+} // namespace
+
+FaceGallery::~FaceGallery()
+{
+    if (m_rebuildThread.joinable()) {
+        m_rebuildThread.join();
+    }
+}
+
+void FaceGallery::enableIndex(int minUsers, int m, int efConstruction, int efSearch, const QString &indexPath)
+{
+    QWriteLocker locker(&m_lock);
+    m_indexMinUsers = std::max(0, minUsers);
+    m_indexM = m;
+    m_indexEfConstruction = efConstruction;
+    m_efSearch = std::max(1, efSearch);
+
+    if (m_usernames.size() < m_indexMinUsers) {
+        qInfo() << "用户数未达到" << m_indexMinUsers << ", 暂不启用 HNSW 索引";
+        return;
+    }
+
+    // 优先复用上次保存的索引，避免启动时重建
+    if (indexPath.isEmpty() || !loadIndexLocked(indexPath)) {
+        rebuildIndexLocked();
+    }
+}
+
+void FaceGallery::enableQuantization(int rerankFactor)
+{
+    QWriteLocker locker(&m_lock);
+    m_quantized = true;
+    m_rerankFactor = std::max(1, rerankFactor);
+    requantizeLocked();
+    qInfo() << "✅ 人脸库启用 int8 量化扫描，重排倍数:" << m_rerankFactor;
+}
+
+void FaceGallery::requantizeLocked()
+{
+    // 每一维按当前人脸库中的最大绝对值确定步长，并留 10% 余量给之后新增的特征
+    const int count = m_usernames.size();
+    std::vector<float> maxAbs(DIMENSION, 0.0f);
+    for (int row = 0; row < count; ++row) {
+        const float *descriptor = m_descriptors.data() + static_cast<size_t>(row) * DIMENSION;
+        for (int i = 0; i < DIMENSION; ++i) {
+            maxAbs[i] = std::max(maxAbs[i], std::fabs(descriptor[i]));
+        }
+    }
+
+    m_scales.resize(DIMENSION);
+    for (int i = 0; i < DIMENSION; ++i) {
+        // 空人脸库时按 dlib 特征的典型取值范围 ±0.5 估计
+        float range = count > 0 ? maxAbs[i] * 1.1f : 0.5f;
+        m_scales[i] = std::max(range, 1e-6f) / 127.0f;
+    }
+
+    m_codes.resize(static_cast<size_t>(count) * DIMENSION);
+    m_clampedRows = 0;
+    for (int row = 0; row < count; ++row) {
+        quantizeRowLocked(row);
+    }
+}
+
+void FaceGallery::quantizeUpsertedRowLocked(int row)
+{
+    // 新特征超出量化范围的维度被截断，粗筛时与其他用户的区分度下降；
+    // 被截断的行累计超过人脸库的 1% 时按当前特征重新确定步长
+    if (quantizeRowLocked(row) && ++m_clampedRows > std::max(16, m_usernames.size() / 100)) {
+        qInfo() << "超出量化范围的特征达到" << m_clampedRows << "个，重新量化人脸库";
+        requantizeLocked();
+    }
+}
+
+bool FaceGallery::spillFloatRows(const QString &directory)
+{
+    QWriteLocker locker(&m_lock);
+    if (!m_descriptors.spillToDirectory(directory.toStdString())) {
+        qWarning() << "无法在" << directory << "创建人脸特征映射文件，float 特征保留在内存中";
+        return false;
+    }
+    qInfo() << "✅ 人脸库 float 特征已移到" << directory << "下的映射文件，常驻内存只保留 int8 量化特征";
+    return true;
+}
+
+bool FaceGallery::quantizeRowLocked(int row)
+{
+    const size_t offset = static_cast<size_t>(row) * DIMENSION;
+    if (m_codes.size() < offset + DIMENSION) {
+        m_codes.resize(offset + DIMENSION);
+    }
+
+    const float *descriptor = m_descriptors.data() + offset;
+    bool clamped = false;
+    for (int i = 0; i < DIMENSION; ++i) {
+        // 超出量化范围的值截断，误差由精确重排兜底
+        float level = std::round(descriptor[i] / m_scales[i]);
+        clamped = clamped || std::fabs(level) > 127.0f;
+        m_codes[offset + i] = static_cast<std::int8_t>(std::max(-127.0f, std::min(127.0f, level)));
+    }
+    return clamped;
+}
+
+void FaceGallery::setEfSearch(int efSearch)
+{
+    QWriteLocker locker(&m_lock);
+    m_efSearch = std::max(1, efSearch);
+}
+
+void FaceGallery::load(const QVector<QPair<QString, QVector<float>>> &entries)
+{
+    QWriteLocker locker(&m_lock);
+    ++m_indexGeneration;
+    m_descriptors.clear();
+    m_usernames.clear();
+    m_rows.clear();
+    m_descriptors.reserve(static_cast<size_t>(entries.size()));
+
+    for (const auto &entry : entries) {
+        if (entry.second.size() < DIMENSION || entry.second.size() % DIMENSION != 0) {
+            qWarning() << "跳过维度异常的人脸特征:" << entry.first << entry.second.size();
+            continue;
+        }
+        m_rows.insert(entry.first, m_usernames.size());
+        m_usernames.append(entry.first);
+        m_descriptors.append(entry.second.constData());
+    }
+
+    qInfo() << "✅ 人脸库加载完成，用户数:" << m_usernames.size();
+
+    if (m_quantized) {
+        requantizeLocked();
+    }
+
+    if (m_indexMinUsers >= 0 && m_usernames.size() >= m_indexMinUsers) {
+        rebuildIndexLocked();
+    } else {
+        m_index.reset();
+    }
+}
+
+void FaceGallery::upsert(const QString &username, const QVector<float> &descriptor)
+{
+    if (descriptor.size() < DIMENSION || descriptor.size() % DIMENSION != 0) {
+        qWarning() << "人脸特征维度异常，未加入人脸库:" << username;
+        return;
+    }
+
+    QWriteLocker locker(&m_lock);
+    auto it = m_rows.constFind(username);
+    if (it != m_rows.constEnd()) {
+        std::copy(descriptor.cbegin(), descriptor.cbegin() + DIMENSION, m_descriptors.row(it.value()));
+        if (m_quantized) {
+            quantizeUpsertedRowLocked(it.value());
+        }
+    } else {
+        m_rows.insert(username, m_usernames.size());
+        m_usernames.append(username);
+        m_descriptors.append(descriptor.constData());
+        if (m_quantized) {
+            quantizeUpsertedRowLocked(m_usernames.size() - 1);
+        }
+    }
+
+    indexChangedLocked(username);
+    if (m_index) {
+        indexInsertLocked(username, descriptor.constData());
+        // 特征变更会留下删除标记，与删除用户一样需要检查
+        if (m_index->deletedCount() * 2 > m_index->nodeCount()) {
+            scheduleRebuildLocked();
+        }
+    } else if (m_indexMinUsers >= 0 && m_usernames.size() >= m_indexMinUsers) {
+        scheduleRebuildLocked();
+    }
+}
+
+void FaceGallery::remove(const QString &username)
+{
+    QWriteLocker locker(&m_lock);
+    auto it = m_rows.find(username);
+    if (it == m_rows.end()) {
+        return;
+    }
+
+    // 用最后一行填补被删除的行，保持存储连续
+    const int row = it.value();
+    const int last = m_usernames.size() - 1;
+    m_rows.erase(it);
+
+    if (row != last) {
+        std::copy(m_descriptors.row(last), m_descriptors.row(last) + DIMENSION, m_descriptors.row(row));
+        if (m_quantized) {
+            std::copy(m_codes.begin() + static_cast<size_t>(last) * DIMENSION,
+                      m_codes.begin() + static_cast<size_t>(last + 1) * DIMENSION,
+                      m_codes.begin() + static_cast<size_t>(row) * DIMENSION);
+        }
+        m_usernames[row] = m_usernames[last];
+        m_rows[m_usernames[row]] = row;
+    }
+
+    m_usernames.removeLast();
+    m_descriptors.truncate(static_cast<size_t>(last));
+    if (m_quantized) {
+        m_codes.resize(static_cast<size_t>(last) * DIMENSION);
+    }
+
+    indexChangedLocked(username);
+    if (m_index) {
+        auto indexIt = m_indexIds.find(username);
+        if (indexIt != m_indexIds.end()) {
+            m_index->markDeleted(indexIt.value());
+            m_indexIds.erase(indexIt);
+        }
+        // 删除标记过多时重建，避免图中堆积大量无效节点
+        if (m_index->deletedCount() * 2 > m_index->nodeCount()) {
+            scheduleRebuildLocked();
+        }
+    }
+}
+
+void FaceGallery::indexInsertLocked(const QString &username, const float *descriptor)
+{
+    // 特征变更：旧节点标记删除，新特征作为新节点插入
+    auto it = m_indexIds.find(username);
+    if (it != m_indexIds.end()) {
+        m_index->markDeleted(it.value());
+    }
+
+    quint32 id = m_index->insert(descriptor);
+    m_indexLabels.append(username);
+    m_indexIds[username] = id;
+}
+
+std::unique_ptr<HnswIndex> FaceGallery::buildIndex(const QVector<QString> &usernames, const float *descriptors,
+                                                   int m, int efConstruction)
+{
+    std::unique_ptr<HnswIndex> index(new HnswIndex(DIMENSION, m, efConstruction));
+    for (int row = 0; row < usernames.size(); ++row) {
+        index->insert(descriptors + static_cast<size_t>(row) * DIMENSION);
+    }
+    return index;
+}
+
+void FaceGallery::rebuildIndexLocked()
+{
+    qInfo() << "正在建立 HNSW 索引，用户数:" << m_usernames.size();
+
+    m_index = buildIndex(m_usernames, m_descriptors.data(), m_indexM, m_indexEfConstruction);
+    m_indexLabels = m_usernames;
+    m_indexIds.clear();
+    for (int row = 0; row < m_usernames.size(); ++row) {
+        m_indexIds.insert(m_usernames[row], static_cast<quint32>(row));
+    }
+
+    qInfo() << "✅ HNSW 索引建立完成";
+}
+
+void FaceGallery::scheduleRebuildLocked()
+{
+    if (m_rebuilding) {
+        return;
+    }
+
+    // 上一次重建的线程已在 finishRebuild 中清除 m_rebuilding，只剩退出前的收尾
+    if (m_rebuildThread.joinable()) {
+        m_rebuildThread.join();
+    }
+
+    // 建图只读快照，不持锁；快照之后的变更记入 m_rebuildDirty，替换前补上
+    m_rebuilding = true;
+    m_rebuildDirty.clear();
+    const quint64 generation = m_indexGeneration;
+    const QVector<QString> usernames = m_usernames;
+    AlignedFloatVector descriptors(m_descriptors.data(), m_descriptors.data() + m_descriptors.rowCount() * DIMENSION);
+    const int m = m_indexM;
+    const int efConstruction = m_indexEfConstruction;
+    qInfo() << "后台重建 HNSW 索引，用户数:" << usernames.size();
+
+    m_rebuildThread = std::thread([this, generation, usernames, descriptors = std::move(descriptors), m, efConstruction]() {
+        std::unique_ptr<HnswIndex> index = buildIndex(usernames, descriptors.data(), m, efConstruction);
+        finishRebuild(generation, std::move(index), usernames);
+    });
+}
+
+void FaceGallery::finishRebuild(quint64 generation, std::unique_ptr<HnswIndex> index, const QVector<QString> &labels)
+{
+    QWriteLocker locker(&m_lock);
+    m_rebuilding = false;
+    if (generation != m_indexGeneration) {
+        qInfo() << "人脸库已重新加载，丢弃后台重建的 HNSW 索引";
+        return;
+    }
+
+    m_index = std::move(index);
+    m_indexLabels = labels;
+    m_indexIds.clear();
+    for (int id = 0; id < labels.size(); ++id) {
+        m_indexIds.insert(labels[id], static_cast<quint32>(id));
+    }
+
+    // 补上建图期间的变更：旧节点标记删除，仍在人脸库中的用户按当前特征重新插入
+    const QSet<QString> &dirty = m_rebuildDirty;
+    for (const QString &username : dirty) {
+        auto it = m_indexIds.find(username);
+        if (it != m_indexIds.end()) {
+            m_index->markDeleted(it.value());
+            m_indexIds.erase(it);
+        }
+        auto row = m_rows.constFind(username);
+        if (row != m_rows.constEnd()) {
+            indexInsertLocked(username, m_descriptors.data() + static_cast<size_t>(row.value()) * DIMENSION);
+        }
+    }
+    qInfo() << "✅ HNSW 索引后台重建完成，节点数:" << m_index->nodeCount()
+            << "建图期间变更:" << m_rebuildDirty.size();
+    m_rebuildDirty.clear();
+}
+
+void FaceGallery::indexChangedLocked(const QString &username)
+{
+    if (m_rebuilding) {
+        m_rebuildDirty.insert(username);
+    }
+}
+
+quint64 FaceGallery::fingerprintLocked() const
+{
+    // 各用户哈希求和，与行顺序无关
+    quint64 fingerprint = 0;
+    for (int row = 0; row < m_usernames.size(); ++row) {
+        QByteArray name = m_usernames[row].toUtf8();
+        quint64 hash = fnv1a(name.constData(), static_cast<size_t>(name.size()));
+        hash = fnv1a(m_descriptors.data() + static_cast<size_t>(row) * DIMENSION, DIMENSION * sizeof(float), hash);
+        fingerprint += hash;
+    }
+    return fingerprint;
+}
+
+bool FaceGallery::saveIndex(const QString &path) const
+{
+    QReadLocker locker(&m_lock);
+    if (!m_index) {
+        return false;
+    }
+
+    std::ofstream out(path.toStdString(), std::ios::binary | std::ios::trunc);
+    if (!out) {
+        qWarning() << "无法写入 HNSW 索引文件:" << path;
+        return false;
+    }
+
+    const quint64 fingerprint = fingerprintLocked();
+    const quint32 labelCount = static_cast<quint32>(m_indexLabels.size());
+    out.write(reinterpret_cast<const char *>(&kIndexFileMagic), sizeof(kIndexFileMagic));
+    out.write(reinterpret_cast<const char *>(&fingerprint), sizeof(fingerprint));
+    out.write(reinterpret_cast<const char *>(&labelCount), sizeof(labelCount));
+    for (const QString &label : m_indexLabels) {
+        QByteArray utf8 = label.toUtf8();
+        quint32 length = static_cast<quint32>(utf8.size());
+        out.write(reinterpret_cast<const char *>(&length), sizeof(length));
+        out.write(utf8.constData(), utf8.size());
+    }
+    m_index->save(out);
+
+    if (!out) {
+        qWarning() << "写入 HNSW 索引文件失败:" << path;
+        return false;
+    }
+    qInfo() << "✅ HNSW 索引已保存:" << path;
+    return true;
+}
+
+bool FaceGallery::loadIndexLocked(const QString &path)
+{
+    std::ifstream in(path.toStdString(), std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    quint32 magic = 0;
+    quint64 fingerprint = 0;
+    quint32 labelCount = 0;
+    in.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+    in.read(reinterpret_cast<char *>(&fingerprint), sizeof(fingerprint));
+    in.read(reinterpret_cast<char *>(&labelCount), sizeof(labelCount));
+    if (!in || magic != kIndexFileMagic) {
+        qWarning() << "HNSW 索引文件格式无效:" << path;
+        return false;
+    }
+
+    if (fingerprint != fingerprintLocked()) {
+        qInfo() << "HNSW 索引文件与当前人脸库不一致，忽略:" << path;
+        return false;
+    }
+
+    // 标签数和长度来自文件，先按文件大小和用户名长度上限校验，避免损坏的文件触发超大分配
+    const std::streamoff labelsBegin = in.tellg();
+    in.seekg(0, std::ios::end);
+    const std::streamoff fileSize = in.tellg();
+    in.seekg(labelsBegin);
+    if (!in || labelCount > static_cast<quint64>(fileSize - labelsBegin) / sizeof(quint32)) {
+        qWarning() << "HNSW 索引文件已损坏:" << path;
+        return false;
+    }
+
+    QVector<QString> labels;
+    labels.reserve(static_cast<int>(labelCount));
+    for (quint32 i = 0; i < labelCount && in; ++i) {
+        quint32 length = 0;
+        in.read(reinterpret_cast<char *>(&length), sizeof(length));
+        if (length > kMaxLabelBytes) {
+            qWarning() << "HNSW 索引文件已损坏:" << path;
+            return false;
+        }
+        QByteArray utf8(static_cast<int>(length), Qt::Uninitialized);
+        in.read(utf8.data(), length);
+        labels.append(QString::fromUtf8(utf8));
+    }
+
+    std::unique_ptr<HnswIndex> index(new HnswIndex(DIMENSION, m_indexM, m_indexEfConstruction));
+    if (!in || !index->load(in) || index->nodeCount() != labelCount) {
+        qWarning() << "读取 HNSW 索引文件失败:" << path;
+        return false;
+    }
+
+    QHash<QString, quint32> ids;
+    for (quint32 id = 0; id < labelCount; ++id) {
+        if (!index->isDeleted(id)) {
+            ids[labels[static_cast<int>(id)]] = id;
+        }
+    }
+
+    m_index = std::move(index);
+    m_indexLabels = labels;
+    m_indexIds = ids;
+    qInfo() << "✅ HNSW 索引已从文件加载:" << path << "节点数:" << labelCount;
+    return true;
+}
+
+QVector<GalleryMatch> FaceGallery::search(const QVector<float> &query, int k) const
+{
+    if (query.size() != DIMENSION || k <= 0) {
+        return {};
+    }
+
+    QReadLocker locker(&m_lock);
+
+    if (m_index) {
+        std::vector<std::pair<float, std::uint32_t>> nearest = m_index->search(query.constData(), k, m_efSearch);
+        // 图检索的距离只用于排序，返回的距离按确定性累加重新计算，阈值判断与 computeDistance 一致
+        QVector<GalleryMatch> matches;
+        matches.reserve(static_cast<int>(nearest.size()));
+        for (const auto &candidate : nearest) {
+            double squared = DistanceKernels::squaredL2Exact(query.constData(), m_index->vectorAt(candidate.second),
+                                                             DIMENSION);
+            matches.append({m_indexLabels[static_cast<int>(candidate.second)], std::sqrt(squared)});
+        }
+        std::stable_sort(matches.begin(), matches.end(),
+                         [](const GalleryMatch &a, const GalleryMatch &b) { return a.distance < b.distance; });
+        return matches;
+    }
+
+    return searchExactLocked(query, k);
+}
+
+QVector<GalleryMatch> FaceGallery::searchExactLocked(const QVector<float> &query, int k) const
+{
+    const size_t count = static_cast<size_t>(m_usernames.size());
+    // 每个工作线程复用自己的距离缓冲区，避免每次检索都分配 count 个 float
+    thread_local std::vector<float> distances;
+    distances.resize(count);
+
+    std::vector<std::pair<float, std::uint32_t>> nearest;
+    if (m_quantized) {
+        // 第一遍：在 int8 量化特征上粗筛候选
+        DistanceKernels::squaredL2Int8Batch(query.constData(), m_codes.data(), m_scales.data(),
+                                            count, DIMENSION, distances.data());
+        DistanceKernels::selectTopK(distances.data(), count, k * m_rerankFactor, nearest);
+    } else {
+        DistanceKernels::squaredL2Batch(query.constData(), m_descriptors.data(), count, DIMENSION, distances.data());
+        DistanceKernels::selectTopK(distances.data(), count, k, nearest);
+    }
+
+    // 第二遍：候选用原始 float 特征按确定性累加精确重排，阈值判断不受量化误差和指令集影响
+    std::vector<std::pair<double, std::uint32_t>> exact;
+    exact.reserve(nearest.size());
+    for (const auto &candidate : nearest) {
+        exact.emplace_back(DistanceKernels::squaredL2Exact(
+                               query.constData(), m_descriptors.row(candidate.second), DIMENSION),
+                           candidate.second);
+    }
+    std::sort(exact.begin(), exact.end());
+    if (exact.size() > static_cast<size_t>(k)) {
+        exact.resize(static_cast<size_t>(k));
+    }
+
+    QVector<GalleryMatch> matches;
+    matches.reserve(static_cast<int>(exact.size()));
+    for (const auto &candidate : exact) {
+        matches.append({m_usernames[static_cast<int>(candidate.second)], std::sqrt(candidate.first)});
+    }
+    return matches;
+}
+
+int FaceGallery::size() const
+{
+    QReadLocker locker(&m_lock);
+    return m_usernames.size();
+}
@@ -1,31 +1,113 @@
 #include "FaceRecognizer.h"
+#include "FaceEmbeddingBatcher.h"
+#include "DistanceKernels.h"
+#include "ShapePredictorCache.h"
 #include <QDebug>
 #include <QByteArray>
+#include <QElapsedTimer>
 #include <dlib/image_processing.h>
+#include <algorithm>
 #include <cmath>
+#include <functional>
+#include <future>
+#include <limits>
+
+namespace {
+
+// 只扫描 JPEG 段头读出图像尺寸（SOF 段），不解码像素；非 JPEG 或数据不完整时返回 false
+bool peekJpegSize(const unsigned char *data, std::size_t size, int &width, int &height)
+{
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+        return false;
+    }
+
+    std::size_t pos = 2;
+    while (pos + 4 <= size) {
+        if (data[pos] != 0xFF) {
+            return false;
+        }
+        unsigned char marker = data[pos + 1];
+        if (marker == 0xFF) {  // 填充字节
+            ++pos;
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {  // 无长度字段的独立标记
+            pos += 2;
+            continue;
+        }
+
+        std::size_t length = (static_cast<std::size_t>(data[pos + 2]) << 8) | data[pos + 3];
+        bool isFrameHeader = marker >= 0xC0 && marker <= 0xCF
+                             && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+        if (isFrameHeader) {
+            if (pos + 9 > size) {
+                return false;
+            }
+            height = (data[pos + 5] << 8) | data[pos + 6];
+            width = (data[pos + 7] << 8) | data[pos + 8];
+            return width > 0 && height > 0;
+        }
+        if (marker == 0xDA || length < 2) {  // 到达扫描数据仍未遇到 SOF
+            return false;
+        }
+        pos += 2 + length;
+    }
+    return false;
+}
+
+// dlib 特征向量转换为 QVector
+QVector<float> toDescriptor(const dlib::matrix<float, 0, 1> &faceDescriptor)
+{
+    QVector<float> descriptor;
+    descriptor.reserve(static_cast<int>(faceDescriptor.size()));
+    for (long i = 0; i < faceDescriptor.size(); ++i) {
+        descriptor.append(faceDescriptor(i));
+    }
+    return descriptor;
+}
+
+} // namespace
 
 FaceRecognizer::FaceRecognizer(QObject *parent) 
-    : QObject(parent), m_modelsLoaded(false)
+    : QObject(parent), m_modelsLoaded(false), m_embeddingBatcher(nullptr),
+      m_detectionMaxSide(0), m_detectionGrayscale(false), m_decodeTargetSide(0),
+      m_lastError(FaceError::None)
 {
-    m_faceDetector = dlib::get_frontal_face_detector();
+    m_faceDetector = FaceDetector::create("hog");
 }
 
 FaceRecognizer::~FaceRecognizer()
 {
 }
 
-bool FaceRecognizer::loadModels(const QString &shapePredictorPath, const QString &faceRecModelPath)
+bool FaceRecognizer::loadModels(const QString &shapePredictorPath, const QString &faceRecModelPath,
+                                const QString &shapePredictorCachePath)
 {
     try {
         qInfo() << "正在加载模型...";
-        
-        // 加载 68 点人脸关键点检测器
-        dlib::deserialize(shapePredictorPath.toStdString()) >> m_shapePredictor;
+        QElapsedTimer timer;
+        timer.start();
+
+        // 68 点人脸关键点检测器与人脸识别网络互不依赖，在两个线程上同时反序列化
+        auto shapePredictorFuture = std::async(std::launch::async, [&]() {
+            auto shapePredictor = std::make_shared<dlib::shape_predictor>();
+            ShapePredictorCache::load(shapePredictorPath, shapePredictorCachePath, *shapePredictor);
+            return shapePredictor;
+        });
+
+        try {
+            QElapsedTimer netTimer;
+            netTimer.start();
+            dlib::deserialize(faceRecModelPath.toStdString()) >> m_faceRecNet;
+            qInfo() << "✅ 人脸识别网络加载成功，用时" << netTimer.elapsed() << "ms";
+        } catch (...) {
+            shapePredictorFuture.wait();
+            throw;
+        }
+
+        m_shapePredictor = shapePredictorFuture.get();
         qInfo() << "✅ 关键点检测器加载成功";
-        
-        // 加载人脸识别网络
-        dlib::deserialize(faceRecModelPath.toStdString()) >> m_faceRecNet;
-        qInfo() << "✅ 人脸识别网络加载成功";
+        qInfo() << "模型加载总用时" << timer.elapsed() << "ms";
         
         m_modelsLoaded = true;
         return true;
@@ -36,95 +118,740 @@ bool FaceRecognizer::loadModels(const QString &shapePredictorPath, const QString
     }
 }
 
-cv::Mat FaceRecognizer::base64ToMat(const QString &base64String)
+bool FaceRecognizer::cloneModelsFrom(const FaceRecognizer &source, bool withRecognitionNet)
 {
-    // 移除 data:image/jpeg;base64, 前缀
-    QString base64Data = base64String;
-    if (base64Data.contains(",")) {
-        base64Data = base64Data.section(',', 1);
+    if (!source.m_modelsLoaded) {
+        qWarning() << "源识别器模型未加载，无法复制";
+        return false;
+    }
+
+    // shape_predictor 的推理接口是 const 的，可安全地在多个副本间共享；
+    // 检测器和 ResNet 在推理时会修改内部缓冲区，必须每个副本一份
+    m_faceDetector = source.m_faceDetector->clone();
+    m_shapePredictor = source.m_shapePredictor;
+    if (withRecognitionNet) {
+        m_faceRecNet = source.m_faceRecNet;
+    }
+    m_modelsLoaded = true;
+    return true;
+}
+
+void FaceRecognizer::setEmbeddingBatcher(FaceEmbeddingBatcher *batcher)
+{
+    m_embeddingBatcher = batcher;
+}
+
+void FaceRecognizer::setFaceDetector(std::unique_ptr<FaceDetector> detector)
+{
+    if (detector) {
+        m_faceDetector = std::move(detector);
+    }
+}
+
+void FaceRecognizer::setDetectionOptions(int maxSide, bool grayscale)
+{
+    m_detectionMaxSide = std::max(0, maxSide);
+    m_detectionGrayscale = grayscale;
+}
+
+void FaceRecognizer::setDecodeTargetSide(int targetSide)
+{
+    m_decodeTargetSide = std::max(0, targetSide);
+}
+
+void FaceRecognizer::setQualityOptions(const FaceQualityOptions &options)
+{
+    m_qualityOptions = options;
+}
+
+QString FaceRecognizer::errorCode(FaceError error)
+{
+    switch (error) {
+    case FaceError::None: return "OK";
+    case FaceError::DecodeFailed: return "IMAGE_DECODE_FAILED";
+    case FaceError::NoFace: return "NO_FACE";
+    case FaceError::FaceTooSmall: return "FACE_TOO_SMALL";
+    case FaceError::TooBlurry: return "FACE_TOO_BLURRY";
+    case FaceError::TooDark: return "FACE_TOO_DARK";
+    case FaceError::TooBright: return "FACE_TOO_BRIGHT";
+    case FaceError::PoseTooLarge: return "FACE_POSE_TOO_LARGE";
+    case FaceError::Inconsistent: return "FACE_TEMPLATES_INCONSISTENT";
+    case FaceError::Internal: return "INTERNAL_ERROR";
+    }
+    return "INTERNAL_ERROR";
+}
+
+QString FaceRecognizer::errorMessage(FaceError error)
+{
+    switch (error) {
+    case FaceError::None: return "成功";
+    case FaceError::DecodeFailed: return "图像解码失败,请上传 JPEG 或 PNG 图像";
+    case FaceError::NoFace: return "未检测到人脸,请确保光线充足并正对摄像头";
+    case FaceError::FaceTooSmall: return "人脸太小,请靠近摄像头";
+    case FaceError::TooBlurry: return "图像模糊,请保持静止后重试";
+    case FaceError::TooDark: return "光线太暗,请在光线充足的环境下重试";
+    case FaceError::TooBright: return "光线过亮,请避免强光直射";
+    case FaceError::PoseTooLarge: return "侧脸角度过大,请正对摄像头";
+    case FaceError::Inconsistent: return "多张人脸图像不是同一个人,请重新采集";
+    case FaceError::Internal: return "人脸识别服务内部错误";
+    }
+    return "人脸识别服务内部错误";
+}
+
+FaceError FaceRecognizer::checkQuality(const cv::Mat &bgrImage, const dlib::full_object_detection &shape,
+                                       int reduction) const
+{
+    const FaceQualityOptions &options = m_qualityOptions;
+    const dlib::rectangle rect = shape.get_rect();
+
+    // 人脸大小按原图像素计算，与解码时是否缩小无关
+    if (options.minFaceSize > 0
+        && std::min(rect.width(), rect.height()) * static_cast<unsigned long>(reduction)
+               < static_cast<unsigned long>(options.minFaceSize)) {
+        return FaceError::FaceTooSmall;
+    }
+
+    cv::Rect roi = cv::Rect(static_cast<int>(rect.left()), static_cast<int>(rect.top()),
+                            static_cast<int>(rect.width()), static_cast<int>(rect.height()))
+                   & cv::Rect(0, 0, bgrImage.cols, bgrImage.rows);
+    if (roi.area() == 0) {
+        return FaceError::NoFace;
+    }
+
+    // 曝光与清晰度只看人脸区域；先缩放到最宽 128 像素，让模糊分数与人脸大小基本无关
+    cv::Mat gray;
+    cv::cvtColor(bgrImage(roi), gray, cv::COLOR_BGR2GRAY);
+    if (gray.cols > 128) {
+        double scale = 128.0 / gray.cols;
+        cv::resize(gray, gray, cv::Size(), scale, scale, cv::INTER_AREA);
+    }
+
+    double brightness = cv::mean(gray)[0];
+    if (options.minBrightness > 0 && brightness < options.minBrightness) {
+        return FaceError::TooDark;
+    }
+    if (options.maxBrightness > 0 && brightness > options.maxBrightness) {
+        return FaceError::TooBright;
+    }
+
+    if (options.minSharpness > 0) {
+        cv::Mat laplacian;
+        cv::Laplacian(gray, laplacian, CV_64F);
+        cv::Scalar mean, stddev;
+        cv::meanStdDev(laplacian, mean, stddev);
+        if (stddev[0] * stddev[0] < options.minSharpness) {
+            return FaceError::TooBlurry;
+        }
+    }
+
+    // 偏航角估计（仅 68 点模型）：正脸时鼻尖(30)到左右外眼角(36/45)的水平距离接近相等
+    if (options.maxYawAsymmetry > 0 && shape.num_parts() == 68) {
+        double toLeft = std::abs(static_cast<double>(shape.part(30).x() - shape.part(36).x()));
+        double toRight = std::abs(static_cast<double>(shape.part(45).x() - shape.part(30).x()));
+        double asymmetry = std::abs(toLeft - toRight) / std::max(1.0, toLeft + toRight);
+        if (asymmetry > options.maxYawAsymmetry) {
+            return FaceError::PoseTooLarge;
+        }
+    }
+
+    return FaceError::None;
+}
+
+std::vector<dlib::rectangle> FaceRecognizer::detectFaces(const cv::Mat &bgrImage)
+{
+    return m_faceDetector->detect(bgrImage, m_detectionMaxSide, m_detectionGrayscale);
+}
+
+bool FaceRecognizer::locateFaceFromHint(const cv::Mat &bgrImage, const QRect &faceHint,
+                                        dlib::full_object_detection &shape)
+{
+    // 人脸框来自客户端：边长不超过图像、位置与图像相交，先校验再做任何坐标运算，之后的面积和偏移都不会溢出
+    const cv::Rect hint(faceHint.x(), faceHint.y(), faceHint.width(), faceHint.height());
+    if (hint.width > bgrImage.cols || hint.height > bgrImage.rows
+        || hint.x <= -hint.width || hint.x >= bgrImage.cols || hint.y <= -hint.height || hint.y >= bgrImage.rows) {
+        return false;
+    }
+    const cv::Rect imageRect(0, 0, bgrImage.cols, bgrImage.rows);
+    if (hint.width < 40 || hint.height < 40 || (hint & imageRect).area() < hint.area() / 2) {
+        return false;
+    }
+
+    // 人脸框四周各扩出一半作为检测区域，并缩放到人脸约 120 像素（HOG 最小检测窗口为 80 像素，其他后端在这一尺度上同样可靠）
+    const cv::Rect roi = cv::Rect(hint.x - hint.width / 2, hint.y - hint.height / 2,
+                                  hint.width * 2, hint.height * 2) & imageRect;
+    const double scale = std::min(1.0, 120.0 / std::max(hint.width, hint.height));
+
+    cv::Mat roiImage;
+    if (m_faceDetector->acceptsGrayscale()) {
+        cv::cvtColor(bgrImage(roi), roiImage, cv::COLOR_BGR2GRAY);
+    } else {
+        roiImage = bgrImage(roi);
+    }
+    if (scale < 1.0) {
+        cv::resize(roiImage, roiImage, cv::Size(), scale, scale, cv::INTER_AREA);
+    }
+
+    std::vector<dlib::rectangle> candidates = m_faceDetector->detectRaw(roiImage);
+
+    // 选与客户端人脸框重叠度（IoU）最高的检测结果
+    cv::Rect best;
+    double bestIoU = 0.0;
+    for (const auto &candidate : candidates) {
+        cv::Rect mapped(roi.x + static_cast<int>(std::lround(candidate.left() / scale)),
+                        roi.y + static_cast<int>(std::lround(candidate.top() / scale)),
+                        static_cast<int>(std::lround(candidate.width() / scale)),
+                        static_cast<int>(std::lround(candidate.height() / scale)));
+        double overlap = (mapped & hint).area();
+        double iou = overlap / (mapped.area() + hint.area() - overlap);
+        if (iou > bestIoU) {
+            bestIoU = iou;
+            best = mapped;
+        }
+    }
+    if (bestIoU < 0.3) {
+        return false;
+    }
+
+    // 关键点校验：绝大多数关键点应落在（适当放宽的）客户端人脸框内
+    dlib::rectangle face(best.x, best.y, best.x + best.width - 1, best.y + best.height - 1);
+    shape = (*m_shapePredictor)(dlib::cv_image<dlib::bgr_pixel>(bgrImage), face);
+
+    const cv::Rect tolerance(hint.x - hint.width / 4, hint.y - hint.height / 4,
+                             hint.width * 3 / 2, hint.height * 3 / 2);
+    unsigned long inside = 0;
+    for (unsigned long i = 0; i < shape.num_parts(); ++i) {
+        const dlib::point &part = shape.part(i);
+        if (tolerance.contains(cv::Point(static_cast<int>(part.x()), static_cast<int>(part.y())))) {
+            ++inside;
+        }
+    }
+    return shape.num_parts() > 0 && inside * 10 >= shape.num_parts() * 9;
+}
+
+cv::Mat FaceRecognizer::base64ToMat(const QString &base64String, int &reduction)
+{
+    QByteArray byteArray = decodeBase64Image(base64String);
+    return decodeImage(byteArray.constData(), static_cast<std::size_t>(byteArray.size()), reduction);
+}
+
+cv::Mat FaceRecognizer::decodeImage(const char *data, std::size_t size, int &reduction)
+{
+    reduction = 1;
+    if (data == nullptr || size == 0) {
+        qWarning() << "图像数据为空";
+        return cv::Mat();
+    }
+
+    // 大尺寸 JPEG 在 DCT 域按 1/2、1/4、1/8 缩小解码，解码耗时和内存随之下降；
+    // 缩小后的最长边仍不小于 m_decodeTargetSide
+    int flags = cv::IMREAD_COLOR;
+    int width = 0;
+    int height = 0;
+    if (m_decodeTargetSide > 0
+        && peekJpegSize(reinterpret_cast<const unsigned char *>(data), size, width, height)) {
+        int longestSide = std::max(width, height);
+        for (int factor : {8, 4, 2}) {
+            if (longestSide / factor >= m_decodeTargetSide) {
+                reduction = factor;
+                break;
+            }
+        }
+        switch (reduction) {
+        case 8: flags = cv::IMREAD_REDUCED_COLOR_8; break;
+        case 4: flags = cv::IMREAD_REDUCED_COLOR_4; break;
+        case 2: flags = cv::IMREAD_REDUCED_COLOR_2; break;
+        default: break;
+        }
     }
 
-    // 解码 base64
-    QByteArray byteArray = QByteArray::fromBase64(base64Data.toUtf8());
-    std::vector<uchar> buffer(byteArray.begin(), byteArray.end());
+    // 用 Mat 头包装调用方的缓冲区，imdecode 直接读取，不复制压缩数据
+    cv::Mat buffer(1, static_cast<int>(size), CV_8UC1, const_cast<char *>(data));
+    cv::Mat image = cv::imdecode(buffer, flags);
 
-    // 解码为 OpenCV 图像
-    cv::Mat image = cv::imdecode(buffer, cv::IMREAD_COLOR);
-    
     if (image.empty()) {
         qWarning() << "图像解码失败";
     }
-    
+
     return image;
 }
 
-QVector<float> FaceRecognizer::extractDescriptorFromBase64(const QString &base64Image)
+QVector<float> FaceRecognizer::extractDescriptorFromBase64(const QString &base64Image, const QRect &faceHint)
+{
+    if (!m_modelsLoaded) {
+        qWarning() << "模型未加载";
+        m_lastError = FaceError::Internal;
+        return {};
+    }
+
+    int reduction = 1;
+    cv::Mat image = base64ToMat(base64Image, reduction);
+    return extractDescriptor(image, faceHint, reduction);
+}
+
+QVector<float> FaceRecognizer::extractDescriptorFromBytes(const char *data, std::size_t size, const QRect &faceHint)
 {
     if (!m_modelsLoaded) {
         qWarning() << "模型未加载";
+        m_lastError = FaceError::Internal;
         return {};
     }
 
-    // 解码图像
-    cv::Mat cvImage = base64ToMat(base64Image);
+    int reduction = 1;
+    cv::Mat image = decodeImage(data, size, reduction);
+    return extractDescriptor(image, faceHint, reduction);
+}
+
+QVector<float> FaceRecognizer::extractDescriptor(const cv::Mat &cvImage, const QRect &faceHint, int reduction)
+{
     if (cvImage.empty()) {
         qWarning() << "无法解码图像";
+        m_lastError = FaceError::DecodeFailed;
         return {};
     }
 
     try {
-        // 转换为 dlib 格式（BGR -> RGB）
-        cv::Mat rgbImage;
-        cv::cvtColor(cvImage, rgbImage, cv::COLOR_BGR2RGB);
-        dlib::cv_image<dlib::rgb_pixel> dlibImage(rgbImage);
-
-        // 检测人脸
-        std::vector<dlib::rectangle> faces = m_faceDetector(dlibImage);
-        
-        if (faces.empty()) {
-            qWarning() << "未检测到人脸";
+        dlib::full_object_detection shape;
+        m_lastError = locateFace(cvImage, faceHint, reduction, shape);
+        if (m_lastError != FaceError::None) {
             return {};
         }
+        return describeFace(cvImage, shape, reduction);
+
+    } catch (const std::exception &e) {
+        qCritical() << "人脸识别失败:" << e.what();
+        m_lastError = FaceError::Internal;
+        return {};
+    }
+}
+
+FaceError FaceRecognizer::locateFace(const cv::Mat &cvImage, const QRect &faceHint, int reduction,
+                                     dlib::full_object_detection &shape)
+{
+    // 客户端人脸框是原图坐标，换算到缩小解码后的图像上
+    QRect hint = faceHint;
+    if (!hint.isNull() && reduction > 1) {
+        hint = QRect(hint.x() / reduction, hint.y() / reduction,
+                     hint.width() / reduction, hint.height() / reduction);
+    }
+
+    // 获取人脸关键点：优先使用客户端提供的人脸框，校验不通过再做全图检测
+    if (!hint.isNull()) {
+        if (locateFaceFromHint(cvImage, hint, shape)) {
+            return FaceError::None;
+        }
+        qInfo() << "客户端人脸框未通过校验，回退到全图检测";
+    }
+
+    // 检测人脸（在缩小后的图像上检测，人脸框已映射回原图坐标）
+    std::vector<dlib::rectangle> faces = detectFaces(cvImage);
+    if (faces.empty()) {
+        qWarning() << "未检测到人脸";
+        return FaceError::NoFace;
+    }
 
-        qInfo() << "检测到" << faces.size() << "个人脸，使用第一个";
+    qInfo() << "检测到" << faces.size() << "个人脸，使用第一个";
+    shape = (*m_shapePredictor)(dlib::cv_image<dlib::bgr_pixel>(cvImage), faces[0]);
+    return FaceError::None;
+}
+
+FaceError FaceRecognizer::prepareChip(const cv::Mat &cvImage, const dlib::full_object_detection &shape,
+                                      int reduction, dlib::matrix<dlib::rgb_pixel> &faceChip)
+{
+    // 质量预检：太小、模糊、曝光异常或侧脸过大的输入不再做 ResNet 推理
+    if (m_qualityOptions.enabled) {
+        FaceError quality = checkQuality(cvImage, shape, reduction);
+        if (quality != FaceError::None) {
+            qWarning() << "人脸质量预检未通过:" << errorCode(quality);
+            return quality;
+        }
+    }
 
-        // 获取人脸关键点
-        dlib::full_object_detection shape = m_shapePredictor(dlibImage, faces[0]);
+    // 提取人脸区域：直接从 BGR 视图采样，RGB 转换只发生在 150x150 的切片上，不再复制整张图像
+    dlib::extract_image_chip(dlib::cv_image<dlib::bgr_pixel>(cvImage),
+                             dlib::get_face_chip_details(shape, 150, 0.25), faceChip);
+    return FaceError::None;
+}
 
-        // 提取人脸区域
-        dlib::matrix<dlib::rgb_pixel> faceChip;
-        dlib::extract_image_chip(dlibImage, dlib::get_face_chip_details(shape, 150, 0.25), faceChip);
+QVector<float> FaceRecognizer::describeFace(const cv::Mat &cvImage, const dlib::full_object_detection &shape,
+                                           int reduction)
+{
+    dlib::matrix<dlib::rgb_pixel> faceChip;
+    m_lastError = prepareChip(cvImage, shape, reduction, faceChip);
+    if (m_lastError != FaceError::None) {
+        return {};
+    }
+
+    // 计算 128-d 特征向量（启用微批处理时与其他请求的切片合并推理）
+    dlib::matrix<float, 0, 1> faceDescriptor = m_embeddingBatcher
+        ? m_embeddingBatcher->submit(std::move(faceChip)).get()
+        : m_faceRecNet(faceChip);
+
+    qInfo() << "✅ 成功提取 128-d 人脸特征";
+    return toDescriptor(faceDescriptor);
+}
+
+QVector<QVector<float>> FaceRecognizer::extractDescriptorsFromImages(const std::vector<ImageBuffer> &images,
+                                                                     const std::vector<QRect> &faceHints,
+                                                                     std::vector<FaceError> &errors)
+{
+    QVector<QVector<float>> descriptors(static_cast<int>(images.size()));
+    errors.assign(images.size(), FaceError::None);
+    if (!m_modelsLoaded) {
+        qWarning() << "模型未加载";
+        errors.assign(images.size(), FaceError::Internal);
+        return descriptors;
+    }
+
+    // 解码、检测、关键点和切片在调用线程上逐张完成（都是 CPU 上的轻量步骤）
+    std::vector<dlib::matrix<dlib::rgb_pixel>> faceChips;
+    std::vector<size_t> chipImages;
+    for (size_t i = 0; i < images.size(); ++i) {
+        int reduction = 1;
+        cv::Mat image = decodeImage(images[i].data, images[i].size, reduction);
+        if (image.empty()) {
+            qWarning() << "无法解码图像";
+            errors[i] = FaceError::DecodeFailed;
+            continue;
+        }
+
+        try {
+            dlib::full_object_detection shape;
+            const QRect hint = i < faceHints.size() ? faceHints[i] : QRect();
+            errors[i] = locateFace(image, hint, reduction, shape);
+            if (errors[i] != FaceError::None) {
+                continue;
+            }
+            dlib::matrix<dlib::rgb_pixel> faceChip;
+            errors[i] = prepareChip(image, shape, reduction, faceChip);
+            if (errors[i] == FaceError::None) {
+                faceChips.push_back(std::move(faceChip));
+                chipImages.push_back(i);
+            }
+        } catch (const std::exception &e) {
+            qCritical() << "人脸识别失败:" << e.what();
+            errors[i] = FaceError::Internal;
+        }
+    }
+    if (faceChips.empty()) {
+        return descriptors;
+    }
+
+    // 所有切片一起推理：启用微批处理时全部提交后再等待，否则直接按批调用网络
+    try {
+        std::vector<dlib::matrix<float, 0, 1>> faceDescriptors;
+        if (m_embeddingBatcher) {
+            std::vector<std::future<dlib::matrix<float, 0, 1>>> pending;
+            pending.reserve(faceChips.size());
+            for (auto &chip : faceChips) {
+                pending.push_back(m_embeddingBatcher->submit(std::move(chip)));
+            }
+            for (auto &future : pending) {
+                faceDescriptors.push_back(future.get());
+            }
+        } else {
+            faceDescriptors = m_faceRecNet(faceChips, faceChips.size());
+        }
+        for (size_t i = 0; i < chipImages.size(); ++i) {
+            descriptors[static_cast<int>(chipImages[i])] = toDescriptor(faceDescriptors[i]);
+        }
+    } catch (const std::exception &e) {
+        qCritical() << "人脸识别失败:" << e.what();
+        for (size_t index : chipImages) {
+            errors[index] = FaceError::Internal;
+        }
+        return descriptors;
+    }
+
+    qInfo() << "✅ 成功提取" << faceChips.size() << "张图像的人脸特征";
+    return descriptors;
+}
+
+int FaceRecognizer::extractDescriptorsFromBurst(const std::vector<ImageBuffer> &frames,
+                                                const std::function<bool(int, const QVector<float> &)> &accept)
+{
+    if (!m_modelsLoaded) {
+        qWarning() << "模型未加载";
+        m_lastError = FaceError::Internal;
+        return 0;
+    }
+
+    // 跟踪置信度（峰值旁瓣比）低于该值视为跟丢，下一帧重新检测
+    const double minTrackConfidence = 7.0;
+
+    dlib::correlation_tracker tracker;
+    bool tracking = false;
+    cv::Size trackedSize;
+    bool described = false;
+    FaceError failure = FaceError::NoFace;
+    int processed = 0;
+
+    for (const ImageBuffer &frame : frames) {
+        const int frameIndex = processed++;
+
+        int reduction = 1;
+        cv::Mat image = decodeImage(frame.data, frame.size, reduction);
+        if (image.empty()) {
+            failure = FaceError::DecodeFailed;
+            tracking = false;
+            continue;
+        }
+
+        try {
+            cv::Mat gray;
+            cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+            dlib::cv_image<unsigned char> grayView(gray);
+
+            // 后续帧用相关滤波跟踪上一帧的人脸位置，只有首帧或跟丢时才做全图检测
+            dlib::rectangle face;
+            bool located = false;
+            if (tracking && image.size() == trackedSize
+                && tracker.update(grayView) >= minTrackConfidence) {
+                dlib::drectangle position = tracker.get_position();
+                face = dlib::rectangle(std::lround(position.left()), std::lround(position.top()),
+                                       std::lround(position.right()), std::lround(position.bottom()));
+                located = true;
+            }
+
+            if (!located) {
+                std::vector<dlib::rectangle> faces = detectFaces(image);
+                if (faces.empty()) {
+                    failure = FaceError::NoFace;
+                    tracking = false;
+                    continue;
+                }
+                face = faces[0];
+                tracker.start_track(grayView, face);
+                tracking = true;
+                trackedSize = image.size();
+            }
+
+            dlib::full_object_detection shape = (*m_shapePredictor)(dlib::cv_image<dlib::bgr_pixel>(image), face);
+            QVector<float> descriptor = describeFace(image, shape, reduction);
+            if (descriptor.isEmpty()) {
+                failure = m_lastError;
+                continue;
+            }
+
+            described = true;
+            if (accept(frameIndex, descriptor)) {
+                qInfo() << "✅ 连拍第" << frameIndex + 1 << "帧通过，提前结束";
+                m_lastError = FaceError::None;
+                return processed;
+            }
+        } catch (const std::exception &e) {
+            qCritical() << "人脸识别失败:" << e.what();
+            failure = FaceError::Internal;
+            tracking = false;
+        }
+    }
+
+    m_lastError = described ? FaceError::None : failure;
+    return processed;
+}
+
+QByteArray FaceRecognizer::decodeBase64Image(const QString &base64String)
+{
+    // 移除 data:image/jpeg;base64, 前缀
+    int comma = base64String.indexOf(',');
+    QStringRef base64Data = comma >= 0 ? base64String.midRef(comma + 1) : base64String.midRef(0);
+    return QByteArray::fromBase64(base64Data.toLatin1());
+}
+
+QVector<FaceDetection> FaceRecognizer::extractAllDescriptorsFromBase64(const QString &base64Image)
+{
+    if (!m_modelsLoaded) {
+        qWarning() << "模型未加载";
+        m_lastError = FaceError::Internal;
+        return {};
+    }
+
+    int reduction = 1;
+    cv::Mat image = base64ToMat(base64Image, reduction);
+    return extractAllDescriptors(image, reduction);
+}
+
+QVector<FaceDetection> FaceRecognizer::extractAllDescriptorsFromBytes(const char *data, std::size_t size)
+{
+    if (!m_modelsLoaded) {
+        qWarning() << "模型未加载";
+        m_lastError = FaceError::Internal;
+        return {};
+    }
+
+    int reduction = 1;
+    cv::Mat image = decodeImage(data, size, reduction);
+    return extractAllDescriptors(image, reduction);
+}
+
+QVector<FaceDetection> FaceRecognizer::extractAllDescriptors(const cv::Mat &cvImage, int reduction)
+{
+    if (cvImage.empty()) {
+        qWarning() << "无法解码图像";
+        m_lastError = FaceError::DecodeFailed;
+        return {};
+    }
+
+    try {
+        std::vector<dlib::rectangle> detected = detectFaces(cvImage);
+        if (detected.empty()) {
+            qWarning() << "未检测到人脸";
+            m_lastError = FaceError::NoFace;
+            return {};
+        }
+
+        // 每个人脸定位关键点、做质量预检并切片；未通过预检的人脸不返回，全部未通过时报告最后一个原因
+        dlib::cv_image<dlib::bgr_pixel> bgrView(cvImage);
+        std::vector<dlib::rectangle> faces;
+        std::vector<dlib::matrix<dlib::rgb_pixel>> faceChips;
+        FaceError rejected = FaceError::None;
+        for (const dlib::rectangle &face : detected) {
+            dlib::full_object_detection shape = (*m_shapePredictor)(bgrView, face);
+            dlib::matrix<dlib::rgb_pixel> faceChip;
+            FaceError quality = prepareChip(cvImage, shape, reduction, faceChip);
+            if (quality != FaceError::None) {
+                rejected = quality;
+                continue;
+            }
+            faces.push_back(face);
+            faceChips.push_back(std::move(faceChip));
+        }
+        if (faceChips.empty()) {
+            m_lastError = rejected;
+            return {};
+        }
 
-        // 计算 128-d 特征向量
-        dlib::matrix<float, 0, 1> faceDescriptor = m_faceRecNet(faceChip);
+        // 所有切片一次性推理：启用微批处理时全部提交后再等待，否则直接按批调用网络
+        std::vector<dlib::matrix<float, 0, 1>> faceDescriptors;
+        if (m_embeddingBatcher) {
+            std::vector<std::future<dlib::matrix<float, 0, 1>>> pending;
+            pending.reserve(faceChips.size());
+            for (auto &chip : faceChips) {
+                pending.push_back(m_embeddingBatcher->submit(std::move(chip)));
+            }
+            for (auto &future : pending) {
+                faceDescriptors.push_back(future.get());
+            }
+        } else {
+            faceDescriptors = m_faceRecNet(faceChips, faceChips.size());
+        }
 
-        // 转换为 QVector
-        QVector<float> descriptor;
-        descriptor.reserve(128);
-        for (long i = 0; i < faceDescriptor.size(); ++i) {
-            descriptor.append(faceDescriptor(i));
+        // 人脸框换算回原图坐标
+        QVector<FaceDetection> detections;
+        detections.reserve(static_cast<int>(faces.size()));
+        for (size_t i = 0; i < faces.size(); ++i) {
+            const dlib::rectangle &face = faces[i];
+            FaceDetection detection;
+            detection.box = QRect(static_cast<int>(face.left()) * reduction,
+                                  static_cast<int>(face.top()) * reduction,
+                                  static_cast<int>(face.width()) * reduction,
+                                  static_cast<int>(face.height()) * reduction);
+            detection.descriptor = toDescriptor(faceDescriptors[i]);
+            detections.append(detection);
         }
 
-        qInfo() << "✅ 成功提取 128-d 人脸特征";
-        return descriptor;
+        qInfo() << "✅ 成功提取" << detections.size() << "个人脸的特征";
+        m_lastError = FaceError::None;
+        return detections;
 
     } catch (const std::exception &e) {
         qCritical() << "人脸识别失败:" << e.what();
+        m_lastError = FaceError::Internal;
         return {};
     }
 }
 
+void FaceRecognizer::warmUp()
+{
+    if (!m_modelsLoaded) {
+        return;
+    }
+
+    try {
+        // 噪声图像上检测器找不到人脸，后续阶段直接使用图像中央的固定人脸框
+        cv::Mat noise(480, 640, CV_8UC3);
+        cv::randu(noise, cv::Scalar::all(0), cv::Scalar::all(255));
+
+        std::vector<uchar> jpeg;
+        cv::imencode(".jpg", noise, jpeg);
+        int reduction = 1;
+        cv::Mat image = decodeImage(reinterpret_cast<const char *>(jpeg.data()), jpeg.size(), reduction);
+
+        detectFaces(image);
+
+        dlib::cv_image<dlib::bgr_pixel> bgrView(image);
+        dlib::full_object_detection shape = (*m_shapePredictor)(bgrView, dlib::rectangle(220, 140, 419, 339));
+        dlib::matrix<dlib::rgb_pixel> faceChip;
+        dlib::extract_image_chip(bgrView, dlib::get_face_chip_details(shape, 150, 0.25), faceChip);
+        // 启用微批处理时本副本的网络不参与推理（可能没有复制），由微批处理器各自预热
+        if (!m_embeddingBatcher) {
+            m_faceRecNet(faceChip);
+        }
+    } catch (const std::exception &e) {
+        qWarning() << "识别器预热失败:" << e.what();
+    }
+}
+
 double FaceRecognizer::computeDistance(const QVector<float> &desc1, const QVector<float> &desc2)
 {
     if (desc1.size() != desc2.size() || desc1.isEmpty()) {
         return 999.0; // 返回一个很大的距离表示不匹配
     }
 
-    double sum = 0.0;
-    for (int i = 0; i < desc1.size(); ++i) {
-        double diff = desc1[i] - desc2[i];
-        sum += diff * diff;
+    // 登录的接受/拒绝取决于这个距离，使用与指令集无关的确定性累加
+    return std::sqrt(DistanceKernels::squaredL2Exact(desc1.constData(), desc2.constData(), desc1.size()));
+}
+
+QVector<float> FaceRecognizer::buildTemplateSet(const QVector<QVector<float>> &descriptors)
+{
+    if (descriptors.size() == 1) {
+        return descriptors.first();
+    }
+
+    QVector<float> templateSet(DESCRIPTOR_SIZE, 0.0f);
+    templateSet.reserve(DESCRIPTOR_SIZE * (descriptors.size() + 1));
+    for (const auto &descriptor : descriptors) {
+        for (int i = 0; i < DESCRIPTOR_SIZE; ++i) {
+            templateSet[i] += descriptor[i] / descriptors.size();
+        }
+    }
+    for (const auto &descriptor : descriptors) {
+        templateSet += descriptor;
+    }
+    return templateSet;
+}
+
+int FaceRecognizer::templateCount(const QVector<float> &templateSet)
+{
+    const int rows = templateSet.size() / DESCRIPTOR_SIZE;
+    return rows > 1 ? rows - 1 : rows;
+}
+
+double FaceRecognizer::computeMinDistance(const QVector<float> &descriptor, const QVector<float> &templateSet)
+{
+    if (templateSet.size() <= DESCRIPTOR_SIZE) {
+        return computeDistance(descriptor, templateSet);
+    }
+    if (descriptor.size() != DESCRIPTOR_SIZE || templateSet.size() % DESCRIPTOR_SIZE != 0) {
+        return 999.0;
     }
 
-    return std::sqrt(sum);
+    // 跳过质心，批量内核一次算出到各模板的距离并选出最近的候选；
+    // 只有候选用确定性累加重新计算，接受/拒绝判断与 computeDistance 一样不受指令集影响。
+    // 取前两个候选：两个模板距离几乎相同时，不同指令集选出的最近模板可能不同，重算后结果仍一致
+    const std::size_t count = static_cast<std::size_t>(templateSet.size() / DESCRIPTOR_SIZE - 1);
+    const float *templates = templateSet.constData() + DESCRIPTOR_SIZE;
+    thread_local std::vector<float> distances;
+    thread_local std::vector<std::pair<float, std::uint32_t>> nearest;
+    distances.resize(count);
+    DistanceKernels::squaredL2Batch(descriptor.constData(), templates, count, DESCRIPTOR_SIZE, distances.data());
+    DistanceKernels::selectTopK(distances.data(), count, 2, nearest);
+
+    double minSquared = std::numeric_limits<double>::max();
+    for (const auto &candidate : nearest) {
+        minSquared = std::min(minSquared, DistanceKernels::squaredL2Exact(
+                                              descriptor.constData(),
+                                              templates + static_cast<std::size_t>(candidate.second) * DESCRIPTOR_SIZE,
+                                              DESCRIPTOR_SIZE));
+    }
+    return std::sqrt(minSquared);
 }
@@ -0,0 +1,149 @@
+#include "FaceRecognizerPool.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <algorithm>
+#include <future>
+
+FaceRecognizerPool::Lease::Lease(FaceRecognizerPool *pool, FaceRecognizer *recognizer)
+    : m_pool(pool), m_recognizer(recognizer)
+{
+}
+
+FaceRecognizerPool::Lease::Lease(Lease &&other) noexcept
+    : m_pool(other.m_pool), m_recognizer(other.m_recognizer)
+{
+    other.m_pool = nullptr;
+    other.m_recognizer = nullptr;
+}
+
+FaceRecognizerPool::Lease::~Lease()
+{
+    if (m_pool && m_recognizer) {
+        m_pool->release(m_recognizer);
+    }
+}
+
+FaceRecognizerPool::FaceRecognizerPool(int size)
+    : m_netsCloned(true)
+{
+    size = std::max(1, size);
+    m_replicas.reserve(size);
+    for (int i = 0; i < size; ++i) {
+        m_replicas.emplace_back(new FaceRecognizer);
+    }
+}
+
+FaceRecognizerPool::~FaceRecognizerPool()
+{
+}
+
+bool FaceRecognizerPool::loadModels(const QString &shapePredictorPath, const QString &faceRecModelPath,
+                                    const QString &shapePredictorCachePath, bool cloneRecognitionNet)
+{
+    // 只反序列化一次，其余副本在内存中复制，避免重复读取模型文件
+    FaceRecognizer &primary = *m_replicas.front();
+    if (!primary.loadModels(shapePredictorPath, faceRecModelPath, shapePredictorCachePath)) {
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (size_t i = 1; i < m_replicas.size(); ++i) {
+        if (!m_replicas[i]->cloneModelsFrom(primary, cloneRecognitionNet)) {
+            return false;
+        }
+    }
+    m_netsCloned = cloneRecognitionNet || m_replicas.size() == 1;
+
+    QMutexLocker locker(&m_mutex);
+    m_idle.clear();
+    for (const auto &replica : m_replicas) {
+        m_idle.push_back(replica.get());
+    }
+
+    qInfo() << "✅ 识别器副本池就绪，副本数:" << m_replicas.size() << "，复制用时" << timer.elapsed() << "ms"
+            << (m_netsCloned ? "" : "（识别网络由微批处理器持有，副本不复制）");
+    return true;
+}
+
+void FaceRecognizerPool::setEmbeddingBatcher(FaceEmbeddingBatcher *batcher)
+{
+    if (batcher == nullptr && !m_netsCloned) {
+        for (size_t i = 1; i < m_replicas.size(); ++i) {
+            m_replicas[i]->cloneModelsFrom(*m_replicas.front());
+        }
+        m_netsCloned = true;
+    }
+    for (const auto &replica : m_replicas) {
+        replica->setEmbeddingBatcher(batcher);
+    }
+}
+
+void FaceRecognizerPool::setFaceDetector(const FaceDetector &prototype)
+{
+    for (const auto &replica : m_replicas) {
+        replica->setFaceDetector(prototype.clone());
+    }
+}
+
+void FaceRecognizerPool::setDetectionOptions(int maxSide, bool grayscale)
+{
+    for (const auto &replica : m_replicas) {
+        replica->setDetectionOptions(maxSide, grayscale);
+    }
+}
+
+void FaceRecognizerPool::setDecodeTargetSide(int targetSide)
+{
+    for (const auto &replica : m_replicas) {
+        replica->setDecodeTargetSide(targetSide);
+    }
+}
+
+void FaceRecognizerPool::setQualityOptions(const FaceQualityOptions &options)
+{
+    for (const auto &replica : m_replicas) {
+        replica->setQualityOptions(options);
+    }
+}
+
+void FaceRecognizerPool::warmUp()
+{
+    std::vector<std::future<void>> pending;
+    pending.reserve(m_replicas.size());
+    for (const auto &replica : m_replicas) {
+        FaceRecognizer *recognizer = replica.get();
+        pending.push_back(std::async(std::launch::async, [recognizer]() { recognizer->warmUp(); }));
+    }
+    for (auto &future : pending) {
+        future.get();
+    }
+}
+
+FaceRecognizerPool::Lease FaceRecognizerPool::acquire()
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_idle.empty()) {
+        m_available.wait(&m_mutex);
+    }
+
+    FaceRecognizer *recognizer = m_idle.back();
+    m_idle.pop_back();
+    return Lease(this, recognizer);
+}
+
+int FaceRecognizerPool::size() const
+{
+    return static_cast<int>(m_replicas.size());
+}
+
+void FaceRecognizerPool::release(FaceRecognizer *recognizer)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_idle.push_back(recognizer);
+    }
+    m_available.wakeOne();
+}
@@ -0,0 +1,133 @@
+#include "FloatRowStore.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// 映射容量的最小增量（行），避免逐行扩展文件
+const std::size_t MIN_MAPPED_ROWS = 1024;
+
+} // namespace
+
+FloatRowStore::FloatRowStore(std::size_t dim)
+    : m_dim(std::max<std::size_t>(1, dim)), m_rows(0), m_fd(-1), m_mapped(nullptr), m_capacity(0)
+{
+}
+
+FloatRowStore::~FloatRowStore()
+{
+    unmap();
+}
+
+bool FloatRowStore::spillToDirectory(const std::string &directory)
+{
+#ifdef __linux__
+    if (m_mapped != nullptr) {
+        return true;
+    }
+
+    std::string path = (directory.empty() ? std::string(".") : directory) + "/face_gallery_rows.XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd < 0) {
+        return false;
+    }
+    unlink(path.c_str());
+
+    m_fd = fd;
+    if (!remap(std::max(m_rows, MIN_MAPPED_ROWS))) {
+        unmap();
+        return false;
+    }
+    if (m_rows > 0) {
+        std::memcpy(m_mapped, m_memory.data(), m_rows * m_dim * sizeof(float));
+    }
+    AlignedFloatVector().swap(m_memory);
+    return true;
+#else
+    (void)directory;
+    return false;
+#endif
+}
+
+void FloatRowStore::append(const float *values)
+{
+    if (m_mapped == nullptr) {
+        m_memory.insert(m_memory.end(), values, values + m_dim);
+    } else {
+        reserve(m_rows + 1);
+        std::memcpy(mutableData() + m_rows * m_dim, values, m_dim * sizeof(float));
+    }
+    ++m_rows;
+}
+
+void FloatRowStore::truncate(std::size_t rows)
+{
+    m_rows = std::min(m_rows, rows);
+    if (m_mapped == nullptr) {
+        m_memory.resize(m_rows * m_dim);
+    }
+}
+
+void FloatRowStore::reserve(std::size_t rows)
+{
+    if (m_mapped == nullptr) {
+        m_memory.reserve(rows * m_dim);
+        return;
+    }
+    if (rows > m_capacity && !remap(std::max({rows, m_capacity * 2, MIN_MAPPED_ROWS}))) {
+        // 磁盘空间不足等原因无法扩展文件时退回内存存储
+        m_memory.assign(m_mapped, m_mapped + m_rows * m_dim);
+        unmap();
+        m_memory.reserve(rows * m_dim);
+    }
+}
+
+bool FloatRowStore::remap(std::size_t capacity)
+{
+#ifdef __linux__
+    const std::size_t bytes = capacity * m_dim * sizeof(float);
+    if (ftruncate(m_fd, static_cast<off_t>(bytes)) != 0) {
+        return false;
+    }
+
+    void *mapped = nullptr;
+    if (m_mapped == nullptr) {
+        mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    } else {
+        mapped = mremap(m_mapped, m_capacity * m_dim * sizeof(float), bytes, MREMAP_MAYMOVE);
+    }
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+
+    // 访问模式是按候选行随机读取，关闭预读
+    madvise(mapped, bytes, MADV_RANDOM);
+    m_mapped = static_cast<float *>(mapped);
+    m_capacity = capacity;
+    return true;
+#else
+    (void)capacity;
+    return false;
+#endif
+}
+
+void FloatRowStore::unmap()
+{
+#ifdef __linux__
+    if (m_mapped != nullptr) {
+        munmap(m_mapped, m_capacity * m_dim * sizeof(float));
+        m_mapped = nullptr;
+    }
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+    m_capacity = 0;
+#endif
+}
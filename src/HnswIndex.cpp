@@ -0,0 +1,445 @@
+#include "HnswIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <queue>
+
+namespace {
+
+const std::uint32_t kMagic = 0x57534E48;  // "HNSW"
+const std::uint32_t kVersion = 1;
+
+// load() 接受的参数上限，超出时视为文件损坏
+const std::uint64_t kMaxLinks = 512;
+const std::uint64_t kMaxEfConstruction = 1 << 16;
+const std::int32_t kMaxLevel = 64;
+const std::uint64_t kMaxNodes = std::uint64_t(1) << 26;
+
+struct CloserFirst
+{
+    bool operator()(const std::pair<float, std::uint32_t> &a, const std::pair<float, std::uint32_t> &b) const
+    {
+        return a.first > b.first;
+    }
+};
+
+// 每个线程一份访问标记表，用递增的轮次号代替每次清零
+struct VisitedMarks
+{
+    std::vector<std::uint32_t> marks;
+    std::uint32_t epoch = 0;
+
+    void reset(std::size_t size)
+    {
+        if (marks.size() < size) {
+            marks.resize(size, 0);
+        }
+        if (++epoch == 0) {
+            std::fill(marks.begin(), marks.end(), 0);
+            epoch = 1;
+        }
+    }
+
+    bool testAndMark(std::uint32_t id)
+    {
+        if (marks[id] == epoch) {
+            return true;
+        }
+        marks[id] = epoch;
+        return false;
+    }
+};
+
+VisitedMarks &visitedMarks()
+{
+    thread_local VisitedMarks visited;
+    return visited;
+}
+
+template <typename T>
+void writeValue(std::ostream &out, const T &value)
+{
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream &in, T &value)
+{
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+// 流中剩余的字节数；不支持定位的流返回上限值，此时由后续读取失败来发现截断
+std::uint64_t remainingBytes(std::istream &in)
+{
+    const std::istream::pos_type current = in.tellg();
+    if (current == std::istream::pos_type(-1) || !in.seekg(0, std::ios::end)) {
+        in.clear();
+        return std::numeric_limits<std::uint64_t>::max();
+    }
+    const std::istream::pos_type end = in.tellg();
+    in.seekg(current);
+    return end >= current ? static_cast<std::uint64_t>(end - current) : 0;
+}
+
+} // namespace
+
+HnswIndex::HnswIndex(int dim, int m, int efConstruction, unsigned seed)
+    : m_dim(dim),
+      m_maxM(static_cast<std::size_t>(std::max(2, m))),
+      m_maxM0(static_cast<std::size_t>(std::max(2, m)) * 2),
+      m_efConstruction(static_cast<std::size_t>(std::max(efConstruction, m))),
+      m_levelMultiplier(1.0 / std::log(static_cast<double>(std::max(2, m)))),
+      m_rng(seed),
+      m_deletedCount(0),
+      m_entryPoint(0),
+      m_maxLevel(-1)
+{
+}
+
+int HnswIndex::randomLevel()
+{
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double r = uniform(m_rng);
+    return static_cast<int>(-std::log(std::max(r, 1e-12)) * m_levelMultiplier);
+}
+
+float HnswIndex::distanceTo(const float *query, std::uint32_t id) const
+{
+    return DistanceKernels::squaredL2(query, vectorAt(id), m_dim);
+}
+
+const std::uint32_t *HnswIndex::neighborData(std::uint32_t node, int level, std::size_t &count) const
+{
+    if (level == 0) {
+        const std::uint32_t *slot = m_level0Links.data() + static_cast<std::size_t>(node) * (m_maxM0 + 1);
+        count = slot[0];
+        return slot + 1;
+    }
+    const std::vector<std::uint32_t> &links = m_upperLinks[node][level - 1];
+    count = links.size();
+    return links.data();
+}
+
+std::vector<std::uint32_t> HnswIndex::neighbors(std::uint32_t node, int level) const
+{
+    std::size_t count = 0;
+    const std::uint32_t *data = neighborData(node, level, count);
+    return std::vector<std::uint32_t>(data, data + count);
+}
+
+void HnswIndex::setNeighbors(std::uint32_t node, int level, const std::vector<std::uint32_t> &links)
+{
+    if (level == 0) {
+        std::uint32_t *slot = m_level0Links.data() + static_cast<std::size_t>(node) * (m_maxM0 + 1);
+        slot[0] = static_cast<std::uint32_t>(links.size());
+        std::copy(links.begin(), links.end(), slot + 1);
+        return;
+    }
+    m_upperLinks[node][level - 1] = links;
+}
+
+std::uint32_t HnswIndex::greedyClosest(const float *query, std::uint32_t entry, int fromLevel, int toLevel) const
+{
+    float best = distanceTo(query, entry);
+    for (int level = fromLevel; level > toLevel; --level) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            std::size_t count = 0;
+            const std::uint32_t *links = neighborData(entry, level, count);
+            for (std::size_t i = 0; i < count; ++i) {
+                float d = distanceTo(query, links[i]);
+                if (d < best) {
+                    best = d;
+                    entry = links[i];
+                    changed = true;
+                }
+            }
+        }
+    }
+    return entry;
+}
+
+std::vector<HnswIndex::Candidate> HnswIndex::searchLayer(const float *query, std::uint32_t entry, std::size_t ef,
+                                                         int level, bool skipDeleted) const
+{
+    VisitedMarks &visited = visitedMarks();
+    visited.reset(m_levels.size());
+
+    std::priority_queue<Candidate, std::vector<Candidate>, CloserFirst> candidates;
+    std::priority_queue<Candidate> results;  // 堆顶是当前结果中最远的
+
+    float entryDistance = distanceTo(query, entry);
+    candidates.emplace(entryDistance, entry);
+    visited.testAndMark(entry);
+    if (!skipDeleted || !m_deleted[entry]) {
+        results.emplace(entryDistance, entry);
+    }
+
+    while (!candidates.empty()) {
+        Candidate current = candidates.top();
+        if (results.size() >= ef && current.first > results.top().first) {
+            break;
+        }
+        candidates.pop();
+
+        std::size_t count = 0;
+        const std::uint32_t *links = neighborData(current.second, level, count);
+        for (std::size_t i = 0; i < count; ++i) {
+            std::uint32_t neighbor = links[i];
+            if (visited.testAndMark(neighbor)) {
+                continue;
+            }
+
+            float d = distanceTo(query, neighbor);
+            if (results.size() < ef || d < results.top().first) {
+                candidates.emplace(d, neighbor);
+                if (!skipDeleted || !m_deleted[neighbor]) {
+                    results.emplace(d, neighbor);
+                    if (results.size() > ef) {
+                        results.pop();
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<Candidate> sorted(results.size());
+    for (std::size_t i = sorted.size(); i > 0; --i) {
+        sorted[i - 1] = results.top();
+        results.pop();
+    }
+    return sorted;
+}
+
+std::vector<std::uint32_t> HnswIndex::selectNeighbors(const std::vector<Candidate> &sortedCandidates,
+                                                      std::size_t maxCount) const
+{
+    // 启发式选邻：候选点离查询点比离任何已选邻居都近时才保留，使连接分布在不同方向上
+    std::vector<std::uint32_t> selected;
+    selected.reserve(maxCount);
+    for (const Candidate &candidate : sortedCandidates) {
+        if (selected.size() >= maxCount) {
+            break;
+        }
+        const float *candidateVector = vectorAt(candidate.second);
+        bool diverse = true;
+        for (std::uint32_t chosen : selected) {
+            if (distanceTo(candidateVector, chosen) < candidate.first) {
+                diverse = false;
+                break;
+            }
+        }
+        if (diverse) {
+            selected.push_back(candidate.second);
+        }
+    }
+    return selected;
+}
+
+void HnswIndex::addLink(std::uint32_t node, std::uint32_t neighbor, int level)
+{
+    const std::size_t maxLinks = level == 0 ? m_maxM0 : m_maxM;
+    std::vector<std::uint32_t> links = neighbors(node, level);
+    if (links.size() < maxLinks) {
+        links.push_back(neighbor);
+        setNeighbors(node, level, links);
+        return;
+    }
+
+    // 邻居已满：连同新邻居一起重新做启发式裁剪
+    const float *nodeVector = vectorAt(node);
+    std::vector<Candidate> candidates;
+    candidates.reserve(links.size() + 1);
+    for (std::uint32_t link : links) {
+        candidates.emplace_back(distanceTo(nodeVector, link), link);
+    }
+    candidates.emplace_back(distanceTo(nodeVector, neighbor), neighbor);
+    std::sort(candidates.begin(), candidates.end());
+    setNeighbors(node, level, selectNeighbors(candidates, maxLinks));
+}
+
+std::uint32_t HnswIndex::insert(const float *vector)
+{
+    const std::uint32_t id = static_cast<std::uint32_t>(m_levels.size());
+    const int level = randomLevel();
+
+    m_vectors.insert(m_vectors.end(), vector, vector + m_dim);
+    m_levels.push_back(level);
+    m_deleted.push_back(0);
+    m_level0Links.resize(m_level0Links.size() + m_maxM0 + 1, 0);
+    m_upperLinks.emplace_back(static_cast<std::size_t>(level));
+
+    if (m_maxLevel < 0) {
+        m_entryPoint = id;
+        m_maxLevel = level;
+        return id;
+    }
+
+    const float *query = vectorAt(id);
+    std::uint32_t entry = greedyClosest(query, m_entryPoint, m_maxLevel, level);
+
+    for (int l = std::min(level, m_maxLevel); l >= 0; --l) {
+        std::vector<Candidate> found = searchLayer(query, entry, m_efConstruction, l, false);
+        // 新节点每层只连 m 个邻居，第 0 层的 2m 上限留给后续节点的反向连接
+        std::vector<std::uint32_t> links = selectNeighbors(found, m_maxM);
+        setNeighbors(id, l, links);
+        for (std::uint32_t link : links) {
+            addLink(link, id, l);
+        }
+        if (!found.empty()) {
+            entry = found.front().second;
+        }
+    }
+
+    if (level > m_maxLevel) {
+        m_maxLevel = level;
+        m_entryPoint = id;
+    }
+    return id;
+}
+
+void HnswIndex::markDeleted(std::uint32_t id)
+{
+    if (id < m_deleted.size() && !m_deleted[id]) {
+        m_deleted[id] = 1;
+        ++m_deletedCount;
+    }
+}
+
+std::vector<std::pair<float, std::uint32_t>> HnswIndex::search(const float *query, int k, int efSearch) const
+{
+    if (m_maxLevel < 0 || k <= 0) {
+        return {};
+    }
+
+    std::uint32_t entry = greedyClosest(query, m_entryPoint, m_maxLevel, 0);
+    std::size_t ef = static_cast<std::size_t>(std::max(efSearch, k));
+    std::vector<Candidate> found = searchLayer(query, entry, ef, 0, true);
+    if (found.size() > static_cast<std::size_t>(k)) {
+        found.resize(static_cast<std::size_t>(k));
+    }
+    return found;
+}
+
+void HnswIndex::save(std::ostream &out) const
+{
+    writeValue(out, kMagic);
+    writeValue(out, kVersion);
+    writeValue(out, static_cast<std::int32_t>(m_dim));
+    writeValue(out, static_cast<std::uint64_t>(m_maxM));
+    writeValue(out, static_cast<std::uint64_t>(m_efConstruction));
+    writeValue(out, static_cast<std::uint64_t>(m_levels.size()));
+    writeValue(out, m_entryPoint);
+    writeValue(out, static_cast<std::int32_t>(m_maxLevel));
+
+    out.write(reinterpret_cast<const char *>(m_vectors.data()),
+              static_cast<std::streamsize>(m_vectors.size() * sizeof(float)));
+    out.write(reinterpret_cast<const char *>(m_deleted.data()), static_cast<std::streamsize>(m_deleted.size()));
+    out.write(reinterpret_cast<const char *>(m_level0Links.data()),
+              static_cast<std::streamsize>(m_level0Links.size() * sizeof(std::uint32_t)));
+
+    for (std::size_t node = 0; node < m_levels.size(); ++node) {
+        writeValue(out, static_cast<std::int32_t>(m_levels[node]));
+        for (const auto &links : m_upperLinks[node]) {
+            writeValue(out, static_cast<std::uint32_t>(links.size()));
+            out.write(reinterpret_cast<const char *>(links.data()),
+                      static_cast<std::streamsize>(links.size() * sizeof(std::uint32_t)));
+        }
+    }
+}
+
+bool HnswIndex::load(std::istream &in)
+{
+    // 索引文件来自磁盘，内容不可信：所有尺寸和节点 id 都先校验再使用，
+    // 任何一项不合法都返回 false 且不修改当前索引，由调用方重新建图
+    std::uint32_t magic = 0, version = 0, entryPoint = 0;
+    std::int32_t dim = 0, maxLevel = -1;
+    std::uint64_t maxM = 0, efConstruction = 0, count = 0;
+    if (!readValue(in, magic) || magic != kMagic || !readValue(in, version) || version != kVersion) {
+        return false;
+    }
+    if (!readValue(in, dim) || dim != m_dim || !readValue(in, maxM) || !readValue(in, efConstruction)
+        || !readValue(in, count) || !readValue(in, entryPoint) || !readValue(in, maxLevel)) {
+        return false;
+    }
+    if (maxM < 2 || maxM > kMaxLinks || efConstruction == 0 || efConstruction > kMaxEfConstruction
+        || maxLevel < -1 || maxLevel > kMaxLevel) {
+        return false;
+    }
+    // 空索引没有入口点；非空索引的入口点必须是已有节点
+    if (count == 0 ? maxLevel != -1 : (maxLevel < 0 || entryPoint >= count)) {
+        return false;
+    }
+
+    const std::size_t maxM0 = static_cast<std::size_t>(maxM) * 2;
+    // 每个节点至少占用的字节数；按文件剩余长度限制节点数，避免损坏的 count 触发超大分配
+    const std::uint64_t nodeBytes = static_cast<std::uint64_t>(m_dim) * sizeof(float) + 1
+                                    + (maxM0 + 1) * sizeof(std::uint32_t) + sizeof(std::int32_t);
+    if (count > kMaxNodes || count > remainingBytes(in) / nodeBytes) {
+        return false;
+    }
+    const std::size_t nodes = static_cast<std::size_t>(count);
+
+    AlignedFloatVector vectors(nodes * m_dim, 0.0f);
+    std::vector<std::uint8_t> deleted(nodes, 0);
+    std::vector<std::uint32_t> level0Links(nodes * (maxM0 + 1), 0);
+    if (!in.read(reinterpret_cast<char *>(vectors.data()), static_cast<std::streamsize>(vectors.size() * sizeof(float)))
+        || !in.read(reinterpret_cast<char *>(deleted.data()), static_cast<std::streamsize>(deleted.size()))
+        || !in.read(reinterpret_cast<char *>(level0Links.data()),
+                    static_cast<std::streamsize>(level0Links.size() * sizeof(std::uint32_t)))) {
+        return false;
+    }
+
+    auto validLinks = [count](const std::uint32_t *links, std::size_t linkCount) {
+        return std::all_of(links, links + linkCount, [count](std::uint32_t id) { return id < count; });
+    };
+    for (std::size_t node = 0; node < nodes; ++node) {
+        const std::uint32_t *slot = level0Links.data() + node * (maxM0 + 1);
+        if (deleted[node] > 1 || slot[0] > maxM0 || !validLinks(slot + 1, slot[0])) {
+            return false;
+        }
+    }
+
+    std::vector<int> levels(nodes, 0);
+    std::vector<std::vector<std::vector<std::uint32_t>>> upperLinks(nodes);
+    for (std::size_t node = 0; node < nodes; ++node) {
+        std::int32_t level = 0;
+        if (!readValue(in, level) || level < 0 || level > maxLevel) {
+            return false;
+        }
+        levels[node] = level;
+        upperLinks[node].resize(static_cast<std::size_t>(level));
+        for (auto &links : upperLinks[node]) {
+            std::uint32_t linkCount = 0;
+            if (!readValue(in, linkCount) || linkCount > maxM) {
+                return false;
+            }
+            links.resize(linkCount);
+            if (!in.read(reinterpret_cast<char *>(links.data()),
+                         static_cast<std::streamsize>(linkCount * sizeof(std::uint32_t)))
+                || !validLinks(links.data(), links.size())) {
+                return false;
+            }
+        }
+    }
+    if (nodes > 0 && levels[entryPoint] != maxLevel) {
+        return false;
+    }
+
+    m_maxM = static_cast<std::size_t>(maxM);
+    m_maxM0 = maxM0;
+    m_efConstruction = static_cast<std::size_t>(efConstruction);
+    m_levelMultiplier = 1.0 / std::log(static_cast<double>(m_maxM));
+    m_entryPoint = entryPoint;
+    m_maxLevel = maxLevel;
+    m_vectors = std::move(vectors);
+    m_deleted = std::move(deleted);
+    m_level0Links = std::move(level0Links);
+    m_levels = std::move(levels);
+    m_upperLinks = std::move(upperLinks);
+    m_deletedCount = static_cast<std::size_t>(std::count(m_deleted.begin(), m_deleted.end(), 1));
+    return true;
+}
@@ -0,0 +1,255 @@
+#include "ShapePredictorCache.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+const char CACHE_MAGIC[4] = {'F', 'S', 'P', 'C'};
+const quint32 CACHE_VERSION = 1;
+
+// 构造 shape_predictor 所需的全部数据
+struct ShapePredictorParts
+{
+    dlib::matrix<float, 0, 1> initialShape;
+    std::vector<std::vector<dlib::impl::regression_tree>> forests;
+    std::vector<std::vector<dlib::vector<float, 2>>> pixelCoordinates;
+};
+
+// 原始模型文件的标识，用于判断缓存是否过期
+struct SourceStamp
+{
+    qint64 size;
+    qint64 modified;
+};
+
+// 按 dlib::shape_predictor 的序列化格式逐项读取原始模型，
+// 再把“锚点 + 偏移”还原成初始形状坐标系下的采样像素坐标
+void readDlibModel(const QString &modelPath, ShapePredictorParts &parts)
+{
+    std::ifstream in(modelPath.toStdString(), std::ios::binary);
+    if (!in) {
+        throw dlib::serialization_error("无法打开模型文件 " + modelPath.toStdString());
+    }
+
+    int version = 0;
+    dlib::deserialize(version, in);
+    if (version != 1) {
+        throw dlib::serialization_error("不支持的 shape_predictor 版本");
+    }
+
+    std::vector<std::vector<unsigned long>> anchorIdx;
+    std::vector<std::vector<dlib::vector<float, 2>>> deltas;
+    dlib::deserialize(parts.initialShape, in);
+    dlib::deserialize(parts.forests, in);
+    dlib::deserialize(anchorIdx, in);
+    dlib::deserialize(deltas, in);
+
+    parts.pixelCoordinates.resize(anchorIdx.size());
+    for (size_t cascade = 0; cascade < anchorIdx.size(); ++cascade) {
+        auto &pixels = parts.pixelCoordinates[cascade];
+        pixels.resize(anchorIdx[cascade].size());
+        for (size_t i = 0; i < pixels.size(); ++i) {
+            long anchor = static_cast<long>(anchorIdx[cascade][i]);
+            dlib::vector<float, 2> landmark(parts.initialShape(anchor * 2), parts.initialShape(anchor * 2 + 1));
+            pixels[i] = landmark + deltas[cascade][i];
+        }
+    }
+}
+
+// 顺序读取内存映射缓冲区，越界时置 ok = false
+struct MappedReader
+{
+    const uchar *pos;
+    const uchar *end;
+    bool ok = true;
+
+    template <typename T>
+    T read()
+    {
+        T value{};
+        readRaw(&value, sizeof(T));
+        return value;
+    }
+
+    // 读取元素个数，并检查剩余数据至少还能容纳这么多个 elementBytes 字节的元素（防止损坏的缓存导致超大分配）
+    quint32 readCount(size_t elementBytes)
+    {
+        quint32 count = read<quint32>();
+        if (static_cast<quint64>(count) * elementBytes > static_cast<quint64>(end - pos)) {
+            ok = false;
+            return 0;
+        }
+        return count;
+    }
+
+    void readFloats(dlib::matrix<float, 0, 1> &values, quint32 count)
+    {
+        values.set_size(count);
+        if (count > 0) {
+            readRaw(&values(0), count * sizeof(float));
+        }
+    }
+
+    void readRaw(void *dest, size_t bytes)
+    {
+        if (!ok || static_cast<size_t>(end - pos) < bytes) {
+            ok = false;
+            return;
+        }
+        std::memcpy(dest, pos, bytes);
+        pos += bytes;
+    }
+};
+
+bool readCache(const QString &cachePath, const SourceStamp &stamp, ShapePredictorParts &parts)
+{
+    QFile file(cachePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    uchar *data = file.map(0, file.size());
+    if (data == nullptr) {
+        return false;
+    }
+
+    MappedReader reader{data, data + file.size()};
+    char magic[4];
+    reader.readRaw(magic, sizeof(magic));
+    if (!reader.ok || std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0
+        || reader.read<quint32>() != CACHE_VERSION
+        || reader.read<qint64>() != stamp.size
+        || reader.read<qint64>() != stamp.modified) {
+        return false;
+    }
+
+    reader.readFloats(parts.initialShape, reader.readCount(sizeof(float)));
+
+    quint32 cascadeCount = reader.readCount(2 * sizeof(quint32));
+    parts.forests.resize(cascadeCount);
+    parts.pixelCoordinates.resize(cascadeCount);
+    for (quint32 cascade = 0; cascade < cascadeCount && reader.ok; ++cascade) {
+        auto &pixels = parts.pixelCoordinates[cascade];
+        pixels.resize(reader.readCount(2 * sizeof(float)));
+        for (auto &pixel : pixels) {
+            pixel.x() = reader.read<float>();
+            pixel.y() = reader.read<float>();
+        }
+
+        auto &forest = parts.forests[cascade];
+        forest.resize(reader.readCount(3 * sizeof(quint32)));
+        for (auto &tree : forest) {
+            tree.splits.resize(reader.readCount(2 * sizeof(quint32) + sizeof(float)));
+            for (auto &split : tree.splits) {
+                split.idx1 = reader.read<quint32>();
+                split.idx2 = reader.read<quint32>();
+                split.thresh = reader.read<float>();
+            }
+
+            tree.leaf_values.resize(reader.readCount(sizeof(float)));
+            quint32 leafSize = reader.readCount(tree.leaf_values.size() * sizeof(float));
+            for (auto &leaf : tree.leaf_values) {
+                reader.readFloats(leaf, leafSize);
+            }
+            if (!reader.ok) {
+                break;
+            }
+        }
+    }
+
+    return reader.ok && reader.pos == reader.end;
+}
+
+bool writeCache(const QString &cachePath, const SourceStamp &stamp, const ShapePredictorParts &parts)
+{
+    QSaveFile file(cachePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    auto write = [&file](const auto &value) {
+        file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    };
+    auto writeFloats = [&file](const dlib::matrix<float, 0, 1> &values) {
+        if (values.size() > 0) {
+            file.write(reinterpret_cast<const char *>(&values(0)), values.size() * sizeof(float));
+        }
+    };
+
+    file.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    write(CACHE_VERSION);
+    write(stamp.size);
+    write(stamp.modified);
+
+    write(static_cast<quint32>(parts.initialShape.size()));
+    writeFloats(parts.initialShape);
+
+    write(static_cast<quint32>(parts.forests.size()));
+    for (size_t cascade = 0; cascade < parts.forests.size(); ++cascade) {
+        const auto &pixels = parts.pixelCoordinates[cascade];
+        write(static_cast<quint32>(pixels.size()));
+        for (const auto &pixel : pixels) {
+            write(pixel.x());
+            write(pixel.y());
+        }
+
+        const auto &forest = parts.forests[cascade];
+        write(static_cast<quint32>(forest.size()));
+        for (const auto &tree : forest) {
+            write(static_cast<quint32>(tree.splits.size()));
+            for (const auto &split : tree.splits) {
+                write(static_cast<quint32>(split.idx1));
+                write(static_cast<quint32>(split.idx2));
+                write(split.thresh);
+            }
+
+            write(static_cast<quint32>(tree.leaf_values.size()));
+            write(static_cast<quint32>(tree.leaf_values.empty() ? 0 : tree.leaf_values.front().size()));
+            for (const auto &leaf : tree.leaf_values) {
+                writeFloats(leaf);
+            }
+        }
+    }
+
+    return file.commit();
+}
+
+} // namespace
+
+void ShapePredictorCache::load(const QString &modelPath, const QString &cachePath, dlib::shape_predictor &predictor)
+{
+    QFileInfo source(modelPath);
+    SourceStamp stamp{source.size(), source.lastModified().toMSecsSinceEpoch()};
+
+    QElapsedTimer timer;
+    timer.start();
+
+    ShapePredictorParts parts;
+    bool fromCache = !cachePath.isEmpty() && readCache(cachePath, stamp, parts);
+    if (!fromCache) {
+        parts = ShapePredictorParts();
+        readDlibModel(modelPath, parts);
+    }
+
+    predictor = dlib::shape_predictor(parts.initialShape, parts.forests, parts.pixelCoordinates);
+
+    if (fromCache) {
+        qInfo() << "关键点模型从缓存加载，用时" << timer.elapsed() << "ms";
+    } else {
+        qInfo() << "关键点模型从原始文件加载，用时" << timer.elapsed() << "ms";
+        if (!cachePath.isEmpty()) {
+            if (writeCache(cachePath, stamp, parts)) {
+                qInfo() << "✅ 关键点模型缓存已写入" << cachePath;
+            } else {
+                qWarning() << "关键点模型缓存写入失败:" << cachePath;
+            }
+        }
+    }
+}
@@ -0,0 +1,127 @@
+#include "UserAuthCache.h"
+#include <QHash>
+#include <QMutexLocker>
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// 记录的近似内存占用（字节），作为 QCache 的 cost
+int recordCost(const QString &username, const UserAuthRecord &record)
+{
+    return static_cast<int>(sizeof(UserAuthRecord) + 64
+                            + (username.size() + record.passwordHash.size()) * sizeof(QChar)
+                            + record.descriptor.size() * sizeof(float));
+}
+
+// username 列为 utf8mb4_unicode_ci（PAD SPACE）：去掉末尾空格并统一大小写，
+// 只差大小写的写法对应同一个缓存键
+QString cacheKey(const QString &username)
+{
+    int length = username.size();
+    while (length > 0 && username.at(length - 1) == QLatin1Char(' ')) {
+        --length;
+    }
+    return username.left(length).toCaseFolded();
+}
+
+} // namespace
+
+UserAuthCache::UserAuthCache(qint64 capacityBytes, int ttlSeconds, int shardCount)
+    : m_capacityBytes(std::max<qint64>(0, capacityBytes)),
+      m_ttlMs(static_cast<qint64>(std::max(0, ttlSeconds)) * 1000)
+{
+    shardCount = std::max(1, shardCount);
+    const qint64 shardCapacity = std::min<qint64>(m_capacityBytes / shardCount, std::numeric_limits<int>::max());
+    for (int i = 0; i < shardCount; ++i) {
+        std::unique_ptr<Shard> shard(new Shard);
+        shard->entries.setMaxCost(static_cast<int>(shardCapacity));
+        m_shards.push_back(std::move(shard));
+    }
+    m_clock.start();
+}
+
+bool UserAuthCache::sameKey(const QString &username, const QString &storedName)
+{
+    return cacheKey(username) == cacheKey(storedName);
+}
+
+UserAuthCache::Shard &UserAuthCache::shardFor(const QString &key)
+{
+    return *m_shards[qHash(key) % m_shards.size()];
+}
+
+bool UserAuthCache::lookup(const QString &username, UserAuthRecord &record, quint64 &generation)
+{
+    if (!isEnabled()) {
+        generation = 0;
+        return false;
+    }
+
+    const QString key = cacheKey(username);
+    Shard &shard = shardFor(key);
+    QMutexLocker locker(&shard.mutex);
+    generation = shard.generation;
+
+    Entry *entry = shard.entries.object(key);
+    if (entry == nullptr || entry->expiresAt <= m_clock.elapsed()) {
+        if (entry != nullptr) {
+            shard.entries.remove(key);
+        }
+        ++m_misses;
+        return false;
+    }
+
+    // QString / QVector 隐式共享，复制只增加引用计数
+    record = entry->record;
+    ++m_hits;
+    return true;
+}
+
+void UserAuthCache::insert(const QString &username, const UserAuthRecord &record, quint64 generation)
+{
+    if (!isEnabled()) {
+        return;
+    }
+
+    const QString key = cacheKey(username);
+    Shard &shard = shardFor(key);
+    QMutexLocker locker(&shard.mutex);
+    if (shard.generation != generation) {
+        return;
+    }
+    shard.entries.insert(key, new Entry{record, m_clock.elapsed() + m_ttlMs}, recordCost(key, record));
+}
+
+void UserAuthCache::invalidate(const QString &username)
+{
+    if (!isEnabled()) {
+        return;
+    }
+
+    const QString key = cacheKey(username);
+    Shard &shard = shardFor(key);
+    QMutexLocker locker(&shard.mutex);
+    shard.entries.remove(key);
+    ++shard.generation;
+}
+
+int UserAuthCache::size() const
+{
+    int total = 0;
+    for (const auto &shard : m_shards) {
+        QMutexLocker locker(&shard->mutex);
+        total += shard->entries.size();
+    }
+    return total;
+}
+
+qint64 UserAuthCache::bytes() const
+{
+    qint64 total = 0;
+    for (const auto &shard : m_shards) {
+        QMutexLocker locker(&shard->mutex);
+        total += shard->entries.totalCost();
+    }
+    return total;
+}
@@ -6,13 +6,35 @@
 #include <QDebug>
 #include <QDateTime>
 #include <QCryptographicHash>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <csignal>
+#include <future>
+#include "CpuTopology.h"
 #include "DatabaseManager.h"
 #include "FaceRecognizer.h"
+#include "FaceDetector.h"
+#include "FaceRecognizerPool.h"
+#include "FaceEmbeddingBatcher.h"
+#include "FaceGallery.h"
+#include "DescriptorCache.h"
+#include "DistanceKernels.h"
 #include "JwtHelper.h"
 #include "httplib.h"
 
 // 状态码:2xx——成功、3xx——重定向、4xx——客户端错误、5xx——服务器错误
 
+// 收到 SIGINT/SIGTERM 后置位,由主线程定时检查并正常退出事件循环(信号处理函数中只做异步安全的操作)
+static std::atomic<bool> g_shutdownRequested(false);
+
+void handleShutdownSignal(int)
+{
+    g_shutdownRequested = true;
+}
+
 // 辅助函数:密码哈希
 QString hashPassword(const QString &password)
 {
@@ -21,6 +43,319 @@ QString hashPassword(const QString &password)
                        .toHex());
 }
 
+// 辅助函数:读取整数环境变量,未设置或非法时返回默认值
+int envInt(const char *name, int defaultValue)
+{
+    bool ok = false;
+    int value = qEnvironmentVariableIntValue(name, &ok);
+    return ok ? value : defaultValue;
+}
+
+// 客户端人脸框坐标和边长的上限(原图像素),远大于可解码的图像尺寸,保证之后的坐标运算不会溢出
+const qint64 MAX_FACE_BOX_COORD = 1 << 16;
+
+// 辅助函数:校验客户端传入的人脸框数值,超出范围或边长非正时返回空 QRect
+QRect makeFaceBox(double x, double y, double width, double height)
+{
+    // NaN 与任何数比较都为 false,同样被拒绝
+    auto inRange = [](double value, double low) { return value >= low && value <= MAX_FACE_BOX_COORD; };
+    if (!inRange(x, -MAX_FACE_BOX_COORD) || !inRange(y, -MAX_FACE_BOX_COORD)
+        || !inRange(width, 1) || !inRange(height, 1)) {
+        return QRect();
+    }
+    return QRect(static_cast<int>(x), static_cast<int>(y), static_cast<int>(width), static_cast<int>(height));
+}
+
+// 辅助函数:读取可选的客户端人脸框 "faceBox": {x, y, width, height}(原图像素坐标),缺失或非法时返回空 QRect
+QRect parseFaceBox(const QJsonObject &bodyJson)
+{
+    if (!bodyJson["faceBox"].isObject()) {
+        return QRect();
+    }
+
+    QJsonObject box = bodyJson["faceBox"].toObject();
+    return makeFaceBox(box["x"].toDouble(), box["y"].toDouble(), box["width"].toDouble(), box["height"].toDouble());
+}
+
+// 辅助函数:解析文本形式的人脸框 "x,y,width,height"(表单字段和请求头使用)
+QRect parseFaceBox(const QString &text)
+{
+    QStringList parts = text.split(',');
+    if (parts.size() != 4) {
+        return QRect();
+    }
+
+    double values[4];
+    for (int i = 0; i < 4; ++i) {
+        bool ok = false;
+        values[i] = parts[i].trimmed().toLongLong(&ok);
+        if (!ok) {
+            return QRect();
+        }
+    }
+    return makeFaceBox(values[0], values[1], values[2], values[3]);
+}
+
+// 人脸类接口的请求参数,支持三种格式:
+//   application/json         —— {"username", "password", "image": base64, "images": [base64...], "faceBox", "topK"}
+//   multipart/form-data      —— 字段 username/password/topK/faceBox,文件 image 为原始图像,连拍帧为多个 images 文件
+//   application/octet-stream —— 请求体即原始图像,其余参数放在 X-Username/X-Password/X-Top-K/X-Face-Box 请求头
+// 二进制格式下 imageData 直接指向 httplib::Request 中的数据,请求处理期间有效
+struct FaceRequest
+{
+    QString username;
+    QString password;
+    QString base64Image;
+    const char *imageData = nullptr;
+    std::size_t imageSize = 0;
+    QRect faceBox;
+    int topK = 5;
+
+    // 连拍帧(JSON 的 "images" 数组或 multipart 的多个 images 文件);base64 帧解码后的数据由 decodedFrames 持有
+    std::vector<ImageBuffer> frames;
+    QVector<QByteArray> decodedFrames;
+
+    bool hasImage() const { return imageSize > 0 || !base64Image.isEmpty(); }
+};
+
+// 辅助函数:按 Content-Type 解析人脸类接口的请求。
+// 连拍帧最多取 maxFrames 帧,其余不解码(JSON 中的 base64 帧在这里解码,超出上限的帧不再占用内存和 CPU);
+// 不使用连拍帧的接口传 0
+FaceRequest parseFaceRequest(const httplib::Request &req, int maxFrames = 0)
+{
+    FaceRequest face;
+
+    if (req.is_multipart_form_data()) {
+        face.username = QString::fromStdString(req.form.get_field("username"));
+        face.password = QString::fromStdString(req.form.get_field("password"));
+        face.faceBox = parseFaceBox(QString::fromStdString(req.form.get_field("faceBox")));
+        if (req.form.has_field("topK")) {
+            face.topK = QString::fromStdString(req.form.get_field("topK")).toInt();
+        }
+
+        // 直接引用表单中的文件内容,避免 get_file() 的整份拷贝
+        auto file = req.form.files.find("image");
+        if (file != req.form.files.end()) {
+            face.imageData = file->second.content.data();
+            face.imageSize = file->second.content.size();
+        }
+        auto frameRange = req.form.files.equal_range("images");
+        for (auto frame = frameRange.first;
+             frame != frameRange.second && static_cast<int>(face.frames.size()) < maxFrames; ++frame) {
+            face.frames.push_back({frame->second.content.data(), frame->second.content.size()});
+        }
+    } else if (req.get_header_value("Content-Type").rfind("application/octet-stream", 0) == 0) {
+        face.username = QString::fromStdString(req.get_header_value("X-Username"));
+        face.password = QString::fromStdString(req.get_header_value("X-Password"));
+        face.faceBox = parseFaceBox(QString::fromStdString(req.get_header_value("X-Face-Box")));
+        if (req.has_header("X-Top-K")) {
+            face.topK = QString::fromStdString(req.get_header_value("X-Top-K")).toInt();
+        }
+        face.imageData = req.body.data();
+        face.imageSize = req.body.size();
+    } else {
+        auto bodyJson = QJsonDocument::fromJson(QByteArray::fromStdString(req.body)).object();
+        face.username = bodyJson["username"].toString();
+        face.password = bodyJson["password"].toString();
+        face.base64Image = bodyJson["image"].toString();
+        face.faceBox = parseFaceBox(bodyJson);
+        face.topK = bodyJson["topK"].toInt(5);
+
+        const QJsonArray frames = bodyJson["images"].toArray();
+        for (int i = 0; i < frames.size() && i < maxFrames; ++i) {
+            face.decodedFrames.append(FaceRecognizer::decodeBase64Image(frames[i].toString()));
+        }
+        for (const QByteArray &frame : face.decodedFrames) {
+            face.frames.push_back({frame.constData(), static_cast<std::size_t>(frame.size())});
+        }
+    }
+
+    face.topK = qBound(1, face.topK, 50);
+    return face;
+}
+
+// 辅助函数:从一张图像的原始字节提取特征向量;失败时 error 给出原因。
+// 先按图像内容哈希查缓存,未命中时才取一个识别器副本做推理
+QVector<float> extractFaceDescriptor(FaceRecognizerPool &pool, DescriptorCache &cache,
+                                     const char *data, std::size_t size, const QRect &faceBox, FaceError &error)
+{
+    QVector<float> descriptor;
+    quint64 key = 0;
+    if (cache.isEnabled()) {
+        key = DescriptorCache::hashKey(data, size, faceBox);
+        if (cache.lookup(key, descriptor, error)) {
+            qInfo() << "特征缓存命中";
+            return descriptor;
+        }
+    }
+
+    {
+        auto recognizer = pool.acquire();
+        descriptor = recognizer->extractDescriptorFromBytes(data, size, faceBox);
+        error = recognizer->lastError();
+    }
+
+    if (cache.isEnabled()) {
+        cache.insert(key, descriptor, error);
+    }
+    return descriptor;
+}
+
+// 辅助函数:从请求中的单张图像("image")提取特征向量
+QVector<float> extractFaceDescriptor(FaceRecognizerPool &pool, DescriptorCache &cache,
+                                     const FaceRequest &face, FaceError &error)
+{
+    // base64 图像先解码为原始字节,与二进制上传的同一张图像命中同一缓存项
+    if (face.imageSize > 0) {
+        return extractFaceDescriptor(pool, cache, face.imageData, face.imageSize, face.faceBox, error);
+    }
+    QByteArray decoded = FaceRecognizer::decodeBase64Image(face.base64Image);
+    return extractFaceDescriptor(pool, cache, decoded.constData(), static_cast<std::size_t>(decoded.size()),
+                                 face.faceBox, error);
+}
+
+// 辅助函数:注册/更新人脸时提取请求中全部图像("image" 与 "images",最多 maxImages 张)的特征并生成模板集。
+// 先逐张查特征缓存;未命中的图像租用一个识别器副本,在当前线程上完成解码和检测后把切片一起提交推理
+// (启用微批处理时与其他请求合批),不额外创建线程。任一张失败或多张图像不是同一个人时返回空
+QVector<float> extractTemplateSet(FaceRecognizerPool &pool, DescriptorCache &cache, const FaceRequest &face,
+                                  int maxImages, FaceError &error)
+{
+    std::vector<ImageBuffer> images;
+    std::vector<QRect> faceHints;
+    QByteArray decodedImage;
+    if (face.imageSize > 0) {
+        images.push_back(ImageBuffer{face.imageData, face.imageSize});
+        faceHints.push_back(face.faceBox);
+    } else if (!face.base64Image.isEmpty()) {
+        // base64 图像先解码为原始字节,与二进制上传的同一张图像命中同一缓存项
+        decodedImage = FaceRecognizer::decodeBase64Image(face.base64Image);
+        images.push_back(ImageBuffer{decodedImage.constData(), static_cast<std::size_t>(decodedImage.size())});
+        faceHints.push_back(face.faceBox);
+    }
+    for (const ImageBuffer &frame : face.frames) {
+        if (static_cast<int>(images.size()) >= maxImages) {
+            break;
+        }
+        images.push_back(frame);
+        faceHints.push_back(QRect());
+    }
+
+    QVector<QVector<float>> descriptors(static_cast<int>(images.size()));
+    std::vector<FaceError> errors(images.size(), FaceError::None);
+    std::vector<quint64> keys(images.size(), 0);
+    std::vector<ImageBuffer> missed;
+    std::vector<QRect> missedHints;
+    std::vector<size_t> missedIndexes;
+    for (size_t i = 0; i < images.size(); ++i) {
+        if (cache.isEnabled()) {
+            keys[i] = DescriptorCache::hashKey(images[i].data, images[i].size, faceHints[i]);
+            if (cache.lookup(keys[i], descriptors[static_cast<int>(i)], errors[i])) {
+                qInfo() << "特征缓存命中";
+                continue;
+            }
+        }
+        missed.push_back(images[i]);
+        missedHints.push_back(faceHints[i]);
+        missedIndexes.push_back(i);
+    }
+
+    if (!missed.empty()) {
+        std::vector<FaceError> missedErrors;
+        QVector<QVector<float>> extracted;
+        {
+            auto recognizer = pool.acquire();
+            extracted = recognizer->extractDescriptorsFromImages(missed, missedHints, missedErrors);
+        }
+        for (size_t j = 0; j < missedIndexes.size(); ++j) {
+            const size_t i = missedIndexes[j];
+            descriptors[static_cast<int>(i)] = extracted[static_cast<int>(j)];
+            errors[i] = missedErrors[j];
+            if (cache.isEnabled()) {
+                cache.insert(keys[i], descriptors[static_cast<int>(i)], errors[i]);
+            }
+        }
+    }
+
+    // 按图像顺序报告第一张失败的原因
+    error = FaceError::None;
+    for (size_t i = 0; i < images.size(); ++i) {
+        if (descriptors[static_cast<int>(i)].isEmpty()) {
+            error = errors[i] != FaceError::None ? errors[i] : FaceError::NoFace;
+            return {};
+        }
+    }
+    if (descriptors.isEmpty()) {
+        error = FaceError::NoFace;
+        return {};
+    }
+
+    // 多张图像必须是同一个人:每个模板到质心的距离都要在 dlib 推荐的同人阈值 0.6 以内
+    QVector<float> templateSet = FaceRecognizer::buildTemplateSet(descriptors);
+    if (descriptors.size() > 1) {
+        QVector<float> centroid = templateSet.mid(0, FaceRecognizer::DESCRIPTOR_SIZE);
+        for (const auto &descriptor : descriptors) {
+            if (FaceRecognizer::computeDistance(descriptor, centroid) >= 0.6) {
+                error = FaceError::Inconsistent;
+                return {};
+            }
+        }
+    }
+    return templateSet;
+}
+
+// 辅助函数:人脸特征提取失败时返回具体原因,code 为机器可读的错误码
+void sendFaceError(httplib::Response &res, FaceError error)
+{
+    QJsonObject response;
+    response["success"] = false;
+    response["code"] = FaceRecognizer::errorCode(error);
+    response["message"] = FaceRecognizer::errorMessage(error);
+    res.status = error == FaceError::Internal ? 500 : 400;
+    res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
+                   "application/json");
+}
+
+// 辅助函数:登录第一、二步——根据认证记录验证用户存在且密码正确,失败时写入 401 响应
+bool verifyUserPassword(const UserAuthRecord &record, const QString &username, const QString &password,
+                        httplib::Response &res)
+{
+    QJsonObject response;
+    response["success"] = false;
+
+    // 第一步: 验证用户是否存在
+    if (!record.exists) {
+        response["message"] = "用户不存在";
+        res.status = 401;
+        res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
+                       "application/json");
+        return false;
+    }
+
+    // 第二步: 验证密码
+    QString hashedPassword = hashPassword(password);
+    const QString &storedPassword = record.passwordHash;
+
+    if (storedPassword.isEmpty()) {
+        response["message"] = "该账号未设置密码,请联系管理员";
+        res.status = 401;
+        res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
+                       "application/json");
+        return false;
+    }
+
+    if (storedPassword != hashedPassword) {
+        qWarning() << "✗ 用户" << username << "密码验证失败";
+        response["message"] = "密码错误";
+        res.status = 401;
+        res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
+                       "application/json");
+        return false;
+    }
+
+    qInfo() << "✓ 用户" << username << "密码验证通过";
+    return true;
+}
+
 // 辅助函数:从请求头提取并验证JWT token
 bool extractAndVerifyToken(const httplib::Request &req, QString &username, httplib::Response &res)
 {
@@ -64,6 +399,49 @@ bool extractAndVerifyToken(const httplib::Request &req, QString &username, httpl
     return true;
 }
 
+// 辅助函数:解析终端凭据 "名称:密钥,名称:密钥",返回 密钥SHA256 -> 名称(只保存哈希,查找耗时与密钥内容无关)
+QHash<QString, QString> parseDeviceKeys(const QString &spec)
+{
+    QHash<QString, QString> devices;
+    for (const QString &item : spec.split(',')) {
+        if (item.trimmed().isEmpty()) {
+            continue;
+        }
+        int colon = item.indexOf(':');
+        QString name = item.left(colon).trimmed();
+        QString key = item.mid(colon + 1).trimmed();
+        if (colon <= 0 || name.isEmpty() || key.length() < 16) {
+            qWarning() << "忽略无效的终端凭据配置(格式为 名称:密钥,密钥至少 16 个字符):" << name;
+            continue;
+        }
+        devices.insert(hashPassword(key), name);
+    }
+    return devices;
+}
+
+// 辅助函数:签到机等终端用 X-Device-Key 认证,其余调用方使用用户 token;通过时输出调用方名称
+bool verifyDeviceOrToken(const httplib::Request &req, const QHash<QString, QString> &deviceKeys,
+                         QString &caller, httplib::Response &res)
+{
+    std::string deviceKey = req.get_header_value("X-Device-Key");
+    if (deviceKey.empty()) {
+        return extractAndVerifyToken(req, caller, res);
+    }
+
+    auto it = deviceKeys.constFind(hashPassword(QString::fromStdString(deviceKey)));
+    if (it == deviceKeys.constEnd()) {
+        QJsonObject response;
+        response["success"] = false;
+        response["message"] = "终端凭据无效";
+        res.status = 401;
+        res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
+                       "application/json");
+        return false;
+    }
+    caller = "device:" + it.value();
+    return true;
+}
+
 int main(int argc, char *argv[])
 {
     QCoreApplication app(argc, argv);
@@ -72,60 +450,287 @@ int main(int argc, char *argv[])
     qInfo() << "  人脸识别服务器 - C++ Qt + dlib 版本";
     qInfo() << "========================================";
 
-    // 初始化数据库
+    QElapsedTimer startupTimer;
+    startupTimer.start();
+
+    // CPU 拓扑:FACE_NUMA_NODE 在创建任何工作线程之前把进程绑定到一个 NUMA 节点,之后的线程都继承该绑定,
+    // 模型权重和推理张量按首次访问分配在本节点内存上
+    std::vector<int> processCpus = CpuTopology::allowedCpus();
+    const std::vector<CpuTopology::NumaNode> numaNodes = CpuTopology::numaNodes();
+    const int numaNode = envInt("FACE_NUMA_NODE", -1);
+    if (numaNode >= 0) {
+        auto node = std::find_if(numaNodes.begin(), numaNodes.end(),
+                                 [numaNode](const CpuTopology::NumaNode &n) { return n.id == numaNode; });
+        std::vector<int> nodeCpus;
+        if (node != numaNodes.end()) {
+            std::set_intersection(processCpus.begin(), processCpus.end(), node->cpus.begin(), node->cpus.end(),
+                                  std::back_inserter(nodeCpus));
+        }
+        if (!nodeCpus.empty() && CpuTopology::pinCurrentThread(nodeCpus)) {
+            processCpus = nodeCpus;
+        } else {
+            qWarning() << "无法绑定到 NUMA 节点" << numaNode << ",使用全部可用 CPU";
+        }
+    }
+    const int cpuCount = processCpus.empty() ? QThread::idealThreadCount() : static_cast<int>(processCpus.size());
+
+    // 单次推理内部的线程数(BLAS / OpenCV),默认 1:并发由副本数和推理线程数提供,两层并行叠加会超额占用核心
+    const int intraOpThreads = qMax(1, envInt("FACE_INTRA_OP_THREADS", 1));
+    const QString intraOpLibraries = QString::fromStdString(CpuTopology::setIntraOpThreads(intraOpThreads));
+
+    // 初始化人脸识别器副本池(每个副本同一时刻只服务一个请求,默认与 CPU 核数一致)
+    // 模型在后台线程加载,与数据库连接同时进行;关键点模型默认使用预解析缓存加速后续启动。
+    // 启用微批处理(批大小>1)时特征全部由推理线程计算,副本不再各自复制一份 ResNet
+    const QString shapePredictorPath = "models/shape_predictor_68_face_landmarks.dat";
+    const int batchMaxSize = envInt("FACE_BATCH_MAX_SIZE", 16);
+    FaceRecognizerPool recognizerPool(envInt("FACE_RECOGNIZER_REPLICAS", cpuCount));
+    auto modelsLoaded = std::async(std::launch::async, [&]() {
+        return recognizerPool.loadModels(
+            shapePredictorPath,
+            "models/dlib_face_recognition_resnet_model_v1.dat",
+            qEnvironmentVariable("FACE_SHAPE_PREDICTOR_CACHE", shapePredictorPath + ".cache"),
+            batchMaxSize <= 1);
+    });
+
+    // HTTP 工作线程数,0 表示使用 httplib 默认值
+    const int httpWorkers = envInt("FACE_HTTP_WORKERS", 0);
+    const int httpWorkerThreads = httpWorkers > 0 ? httpWorkers : static_cast<int>(CPPHTTPLIB_THREAD_POOL_COUNT);
+
+    // 初始化数据库:每个 HTTP 工作线程使用自己的连接,查询可以并行执行;
+    // 连接只能由所属线程关闭,上限默认按 HTTP 工作线程数加上主线程和后台任务线程计算,保证每个线程都能分到连接
     DatabaseManager db;
+    db.setPoolOptions(envInt("FACE_DB_POOL_MAX", httpWorkerThreads + 4));
+    // 最近登录时间在内存中合并,定时(或积累一批后)用一条多行 UPDATE 写入;FACE_LAST_LOGIN_FLUSH_MS=0 时同步写入
+    db.setLastLoginOptions(envInt("FACE_LAST_LOGIN_FLUSH_MS", 1000), envInt("FACE_LAST_LOGIN_BATCH", 200));
+    // 用户认证记录(密码哈希、人脸特征)缓存在进程内,写入用户数据时同步失效;FACE_AUTH_CACHE_MB=0 时关闭
+    db.setAuthCacheOptions(static_cast<qint64>(qMax(0, envInt("FACE_AUTH_CACHE_MB", 64))) * 1024 * 1024,
+                           envInt("FACE_AUTH_CACHE_TTL_SEC", 300));
     if (!db.initialize("127.0.0.1", 3306, "face_recognition_db", "faceuser", "FacePass2025"))
     {
         qCritical() << "数据库初始化失败,退出";
         return -1;
     }
+    qInfo() << "启动阶段: 数据库就绪" << startupTimer.elapsed() << "ms";
 
-    // 初始化人脸识别器
-    FaceRecognizer recognizer;
-    if (!recognizer.loadModels(
-            "models/shape_predictor_68_face_landmarks.dat",
-            "models/dlib_face_recognition_resnet_model_v1.dat"))
+    if (!modelsLoaded.get())
     {
         qCritical() << "模型加载失败,退出";
         return -1;
     }
+    qInfo() << "启动阶段: 模型就绪" << startupTimer.elapsed() << "ms";
+
+    // 人脸检测后端:hog(默认)/mmod/yunet,模型路径可由 FACE_DETECTOR_MODEL 覆盖;加载失败时继续使用 HOG
+    const QString detectorBackend = qEnvironmentVariable("FACE_DETECTOR", "hog").toLower();
+    if (detectorBackend != "hog") {
+        try {
+            std::unique_ptr<FaceDetector> detector = FaceDetector::create(
+                detectorBackend.toStdString(), qEnvironmentVariable("FACE_DETECTOR_MODEL").toStdString());
+            recognizerPool.setFaceDetector(*detector);
+            qInfo() << "✅ 人脸检测后端:" << detectorBackend;
+        } catch (const std::exception &e) {
+            qWarning() << "人脸检测后端" << detectorBackend << "加载失败,改用 HOG:" << e.what();
+        }
+    }
+
+    // 人脸检测在缩小后的图像上进行(默认最长边 640 像素、灰度),关键点和切片仍使用原图
+    recognizerPool.setDetectionOptions(envInt("FACE_DETECT_MAX_SIDE", 640),
+                                       envInt("FACE_DETECT_GRAYSCALE", 1) != 0);
+    recognizerPool.setDecodeTargetSide(envInt("FACE_DECODE_TARGET_SIDE", 1280));
+
+    // 质量预检:太小、模糊、曝光异常或侧脸过大的人脸在 ResNet 推理前直接拒绝并返回具体错误码
+    FaceQualityOptions qualityOptions;
+    qualityOptions.enabled = envInt("FACE_QUALITY_GATE", 1) != 0;
+    qualityOptions.minFaceSize = envInt("FACE_QUALITY_MIN_SIZE", qualityOptions.minFaceSize);
+    qualityOptions.minSharpness = envInt("FACE_QUALITY_MIN_SHARPNESS", static_cast<int>(qualityOptions.minSharpness));
+    qualityOptions.minBrightness = envInt("FACE_QUALITY_MIN_BRIGHTNESS", qualityOptions.minBrightness);
+    qualityOptions.maxBrightness = envInt("FACE_QUALITY_MAX_BRIGHTNESS", qualityOptions.maxBrightness);
+    qualityOptions.maxYawAsymmetry = envInt("FACE_QUALITY_MAX_YAW", static_cast<int>(qualityOptions.maxYawAsymmetry * 100)) / 100.0;
+    recognizerPool.setQualityOptions(qualityOptions);
+
+    // 跨请求微批处理:并发请求的人脸切片合并后一次送入 ResNet,批大小<=1 时关闭
+    // FACE_INFERENCE_CPUS(如 "0-7")非空时推理线程各自绑定其中一段 CPU
+    std::vector<int> inferenceCpus;
+    const QString inferenceCpuList = qEnvironmentVariable("FACE_INFERENCE_CPUS");
+    if (!inferenceCpuList.isEmpty()) {
+        const std::vector<int> requested = CpuTopology::parseCpuList(inferenceCpuList.toStdString());
+        std::set_intersection(requested.begin(), requested.end(), processCpus.begin(), processCpus.end(),
+                              std::back_inserter(inferenceCpus));
+        if (inferenceCpus.size() != requested.size()) {
+            qWarning() << "FACE_INFERENCE_CPUS 中部分 CPU 不可用,实际绑定"
+                       << QString::fromStdString(CpuTopology::formatCpuList(inferenceCpus));
+        }
+    }
+
+    std::unique_ptr<FaceEmbeddingBatcher> embeddingBatcher;
+    const int batchWorkers = qMax(1, envInt("FACE_BATCH_WORKERS", qMax(1, cpuCount / 4)));
+    if (batchMaxSize > 1) {
+        embeddingBatcher.reset(new FaceEmbeddingBatcher(
+            recognizerPool.primary().faceRecNet(),
+            batchMaxSize,
+            envInt("FACE_BATCH_WINDOW_US", 2000),
+            batchWorkers,
+            inferenceCpus));
+        recognizerPool.setEmbeddingBatcher(embeddingBatcher.get());
+    } else if (!inferenceCpus.empty()) {
+        qWarning() << "未启用微批处理,推理在 HTTP 工作线程上执行,FACE_INFERENCE_CPUS 不生效";
+    }
 
-    // 创建 HTTP 服务器
+    // 拓扑报告:推理并发(推理线程或副本数)乘以单次推理内部线程数超过可用 CPU 时各推理相互抢核,延迟抖动
+    const int inferenceConcurrency = embeddingBatcher ? batchWorkers : recognizerPool.size();
+    qInfo() << "CPU 拓扑: 可用 CPU" << QString::fromStdString(CpuTopology::formatCpuList(processCpus))
+            << "(" << cpuCount << "个), NUMA 节点" << numaNodes.size() << "个"
+            << (numaNode >= 0 ? QString(",进程绑定到节点 %1").arg(numaNode) : QString());
+    for (const auto &node : numaNodes) {
+        qInfo() << "  NUMA 节点" << node.id << ": CPU" << QString::fromStdString(CpuTopology::formatCpuList(node.cpus));
+    }
+    qInfo() << "推理配置: 识别器副本" << recognizerPool.size()
+            << ", 推理线程" << (embeddingBatcher ? QString::number(batchWorkers) : QString("未启用(在 HTTP 线程上推理)"))
+            << ", 单次推理内部线程" << intraOpThreads << "(" << intraOpLibraries << ")"
+            << ", HTTP 工作线程" << httpWorkerThreads << (httpWorkers > 0 ? "" : "(httplib 默认)");
+    if (inferenceConcurrency * intraOpThreads > cpuCount) {
+        qWarning() << "推理并发" << inferenceConcurrency << "x 内部线程" << intraOpThreads
+                   << "超过可用 CPU 数" << cpuCount << ",可能超额占用核心";
+    }
+
+    // 加载内存人脸库(1:N 检索),之后随注册/更新/删除同步
+    // 精确检索先扫 int8 量化特征再用 float 重排,FACE_GALLERY_RERANK=0 时直接扫 float 特征;
+    // 量化扫描时 float 特征只在重排时读取少数几行,在加载前移到磁盘映射文件中,不占常驻内存
+    FaceGallery gallery;
+    int rerankFactor = envInt("FACE_GALLERY_RERANK", 4);
+    const QString spillDir = qEnvironmentVariable("FACE_GALLERY_SPILL_DIR", ".");
+    if (rerankFactor > 0 && !spillDir.isEmpty()) {
+        gallery.spillFloatRows(spillDir);
+    }
+    gallery.load(db.getAllDescriptors());
+    if (rerankFactor > 0) {
+        gallery.enableQuantization(rerankFactor);
+    }
+
+    // 用户数达到阈值后启用 HNSW 近似检索,FACE_ANN_MIN_USERS=-1 时始终精确检索
+    const QString annIndexPath = qEnvironmentVariable("FACE_ANN_INDEX_PATH", "face_gallery.hnsw");
+    int annMinUsers = envInt("FACE_ANN_MIN_USERS", 50000);
+    if (annMinUsers >= 0) {
+        gallery.enableIndex(annMinUsers,
+                            envInt("FACE_ANN_M", 16),
+                            envInt("FACE_ANN_EF_CONSTRUCTION", 200),
+                            envInt("FACE_ANN_EF_SEARCH", 64),
+                            annIndexPath);
+    }
+    qInfo() << "启动阶段: 人脸库就绪" << startupTimer.elapsed() << "ms";
+    qInfo() << "特征距离计算指令集:" << DistanceKernels::isaName();
+    QObject::connect(&db, &DatabaseManager::userDescriptorChanged,
+                     [&gallery](const QString &username, const QVector<float> &descriptor) {
+                         gallery.upsert(username, descriptor);
+                     });
+    QObject::connect(&db, &DatabaseManager::userRemoved,
+                     [&gallery](const QString &username) { gallery.remove(username); });
+
+    // 创建 HTTP 服务器;FACE_HTTP_WORKERS 为 0 时使用 httplib 默认的线程数
     httplib::Server svr;
+    if (httpWorkers > 0) {
+        svr.new_task_queue = [httpWorkers]() { return new httplib::ThreadPool(static_cast<size_t>(httpWorkers)); };
+    }
+
+    // 按图像内容缓存特征提取结果,客户端重试同一张图像时跳过推理;FACE_CACHE_SIZE=0 时关闭
+    DescriptorCache descriptorCache(envInt("FACE_CACHE_SIZE", 1024), envInt("FACE_CACHE_TTL_SEC", 60));
+
+    // 注册/更新人脸时单次最多使用的图像数(多张图像生成模板集,登录时与每个模板比对)
+    const int enrollMaxImages = qMax(1, envInt("FACE_ENROLL_MAX_IMAGES", 5));
+
+    // 连拍登录单次最多处理的帧数
+    const int burstMaxFrames = qMax(1, envInt("FACE_BURST_MAX_FRAMES", 10));
+
+    // 1:N 识别终端(签到机、门禁)的凭据,识别的是终端前的人,终端本身不以用户身份登录
+    const QHash<QString, QString> deviceKeys = parseDeviceKeys(qEnvironmentVariable("FACE_DEVICE_KEYS"));
+    if (!deviceKeys.isEmpty()) {
+        qInfo() << "已配置识别终端" << deviceKeys.size() << "个";
+    }
+
+    // 预热完成前为 false:/api/ready 返回 503,需要人脸识别的接口直接拒绝
+    std::atomic<bool> serviceReady(false);
 
     // 设置 CORS(允许前端跨域访问)
-    svr.set_pre_routing_handler([](const httplib::Request &req, httplib::Response &res)
+    svr.set_pre_routing_handler([&serviceReady](const httplib::Request &req, httplib::Response &res)
                                 {
         res.set_header("Access-Control-Allow-Origin", "*");
         res.set_header("Access-Control-Allow-Methods", "GET, POST, OPTIONS");
-        res.set_header("Access-Control-Allow-Headers", "Content-Type, Authorization");
+        res.set_header("Access-Control-Allow-Headers", "Content-Type, Authorization, X-Device-Key");
         
         if (req.method == "OPTIONS") {
             res.status = 200;
             return httplib::Server::HandlerResponse::Handled;
         }
+
+        bool needsRecognizer = req.path.rfind("/api/face/", 0) == 0 || req.path == "/api/user/face";
+        if (needsRecognizer && !serviceReady) {
+            QJsonObject response;
+            response["success"] = false;
+            response["message"] = "服务正在预热,请稍后重试";
+            res.status = 503;
+            res.set_header("Retry-After", "1");
+            res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
+                           "application/json");
+            return httplib::Server::HandlerResponse::Handled;
+        }
         return httplib::Server::HandlerResponse::Unhandled; });
 
     // ========== API: 健康检查 ==========
-    svr.Get("/api/health", [](const httplib::Request &, httplib::Response &res)
+    svr.Get("/api/health", [&descriptorCache, &db](const httplib::Request &, httplib::Response &res)
             {
         QJsonObject json;
         json["status"] = "ok";
         json["message"] = "服务运行正常";
         json["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+
+        quint64 cacheHits = descriptorCache.hits();
+        quint64 cacheLookups = cacheHits + descriptorCache.misses();
+        QJsonObject cacheStats;
+        cacheStats["size"] = descriptorCache.size();
+        cacheStats["hits"] = static_cast<double>(cacheHits);
+        cacheStats["misses"] = static_cast<double>(descriptorCache.misses());
+        cacheStats["hitRate"] = cacheLookups > 0 ? static_cast<double>(cacheHits) / cacheLookups : 0.0;
+        json["descriptorCache"] = cacheStats;
+
+        const UserAuthCache &authCache = db.authCache();
+        quint64 authHits = authCache.hits();
+        quint64 authLookups = authHits + authCache.misses();
+        QJsonObject authStats;
+        authStats["size"] = authCache.size();
+        authStats["bytes"] = static_cast<double>(authCache.bytes());
+        authStats["hits"] = static_cast<double>(authHits);
+        authStats["misses"] = static_cast<double>(authCache.misses());
+        authStats["hitRate"] = authLookups > 0 ? static_cast<double>(authHits) / authLookups : 0.0;
+        json["authCache"] = authStats;
+
+        QJsonObject poolStats;
+        poolStats["open"] = db.connectionCount();
+        poolStats["inUse"] = db.connectionsInUse();
+        poolStats["max"] = db.maxConnections();
+        json["dbConnections"] = poolStats;
         
         res.set_content(QJsonDocument(json).toJson(QJsonDocument::Compact).toStdString(), 
                        "application/json"); });
 
+    // 就绪检查:模型预热完成后才返回 200,供负载均衡/编排系统决定何时导入流量
+    svr.Get("/api/ready", [&serviceReady](const httplib::Request &, httplib::Response &res)
+            {
+        QJsonObject json;
+        json["ready"] = serviceReady.load();
+        json["message"] = serviceReady ? "服务已就绪" : "服务正在预热";
+        json["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+        res.status = serviceReady ? 200 : 503;
+
+        res.set_content(QJsonDocument(json).toJson(QJsonDocument::Compact).toStdString(),
+                       "application/json"); });
+
     // ========== API: 用户注册 ==========
     svr.Post("/api/face/register", [&](const httplib::Request &req, httplib::Response &res)
              {
         qInfo() << "收到注册请求";
         
-        auto bodyJson = QJsonDocument::fromJson(QByteArray::fromStdString(req.body)).object();
-        QString username = bodyJson["username"].toString();
-        QString password = bodyJson["password"].toString();
-        QString image = bodyJson["image"].toString();
+        FaceRequest face = parseFaceRequest(req, enrollMaxImages);
+        QString username = face.username;
+        QString password = face.password;
 
         QJsonObject response;
 
@@ -139,7 +744,8 @@ int main(int argc, char *argv[])
             return;
         }
 
-        if (password.isEmpty() && image.isEmpty()) {
+        bool hasFaceImages = face.hasImage() || !face.frames.empty();
+        if (password.isEmpty() && !hasFaceImages) {
             response["success"] = false;
             response["message"] = "密码和人脸信息至少需要提供一个";
             res.status = 400;
@@ -148,8 +754,8 @@ int main(int argc, char *argv[])
             return;
         }
 
-        // 检查用户是否已存在
-        if (db.userExists(username)) {
+        // 检查用户是否已存在(提前拒绝,避免为已存在的用户做人脸推理)
+        if (db.getAuthRecord(username).exists) {
             response["success"] = false;
             response["message"] = "用户名已存在";
             res.status = 400;
@@ -160,14 +766,11 @@ int main(int argc, char *argv[])
 
         // 处理人脸特征
         QVector<float> descriptor;
-        if (!image.isEmpty()) {
-            descriptor = recognizer.extractDescriptorFromBase64(image);
+        if (hasFaceImages) {
+            FaceError faceError = FaceError::None;
+            descriptor = extractTemplateSet(recognizerPool, descriptorCache, face, enrollMaxImages, faceError);
             if (descriptor.isEmpty()) {
-                response["success"] = false;
-                response["message"] = "未检测到人脸,请确保光线充足并正对摄像头";
-                res.status = 400;
-                res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
-                               "application/json");
+                sendFaceError(res, faceError);
                 return;
             }
         }
@@ -193,6 +796,7 @@ int main(int argc, char *argv[])
         response["username"] = username;
         response["hasFace"] = !descriptor.isEmpty();
         response["hasPassword"] = !password.isEmpty();
+        response["faceTemplates"] = descriptor.isEmpty() ? 0 : FaceRecognizer::templateCount(descriptor);
         
         qInfo() << "✅ 用户" << username << "注册成功";
         
@@ -204,15 +808,14 @@ int main(int argc, char *argv[])
              {
         qInfo() << "收到登录请求";
         
-        auto bodyJson = QJsonDocument::fromJson(QByteArray::fromStdString(req.body)).object();
-        QString username = bodyJson["username"].toString();
-        QString password = bodyJson["password"].toString();
-        QString image = bodyJson["image"].toString();
+        FaceRequest face = parseFaceRequest(req);
+        QString username = face.username;
+        QString password = face.password;
 
         QJsonObject response;
 
         // 强制要求所有字段
-        if (username.isEmpty() || password.isEmpty() || image.isEmpty()) {
+        if (username.isEmpty() || password.isEmpty() || !face.hasImage()) {
             response["success"] = false;
             response["message"] = "请提供完整的认证信息(账号+密码+人脸)";
             res.status = 400;
@@ -221,55 +824,88 @@ int main(int argc, char *argv[])
             return;
         }
 
-        // 第一步: 验证用户是否存在
-        if (!db.userExists(username)) {
-            response["success"] = false;
-            response["message"] = "用户不存在";
-            res.status = 401;
-            res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
-                        "application/json");
+        // 第一、二步: 验证用户与密码(认证记录一次查询取回,人脸比对复用其中的特征)
+        UserAuthRecord authRecord = db.getAuthRecord(username);
+        if (!verifyUserPassword(authRecord, username, password, res)) {
             return;
         }
 
-        // 第二步: 验证密码
-        QString hashedPassword = hashPassword(password);
-        QString storedPassword = db.getUserPassword(username);
+        // 第三步: 验证人脸
+        FaceError faceError = FaceError::None;
+        QVector<float> descriptor = extractFaceDescriptor(recognizerPool, descriptorCache, face, faceError);
+        if (descriptor.isEmpty()) {
+            sendFaceError(res, faceError);
+            return;
+        }
+
+        const QVector<float> &storedDescriptor = authRecord.descriptor;
         
-        if (storedPassword.isEmpty()) {
+        if (storedDescriptor.isEmpty()) {
             response["success"] = false;
-            response["message"] = "该账号未设置密码,请联系管理员";
+            response["message"] = "该账号未录入人脸信息,请联系管理员";
             res.status = 401;
             res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
                         "application/json");
             return;
         }
 
-        if (storedPassword != hashedPassword) {
-            qWarning() << "✗ 用户" << username << "密码验证失败";
+        double distance = FaceRecognizer::computeMinDistance(descriptor, storedDescriptor);
+        qInfo() << "与用户" << username << "的人脸距离:" << distance;
+        
+        if (distance >= FaceRecognizer::MATCH_THRESHOLD) {
+            qWarning() << "✗ 用户" << username << "人脸验证失败 (距离:" << distance << ")";
             response["success"] = false;
-            response["message"] = "密码错误";
+            response["message"] = QString("人脸识别失败,相似度不足 (距离: %1)").arg(distance, 0, 'f', 3);
             res.status = 401;
             res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
                         "application/json");
             return;
         }
 
-        qInfo() << "✓ 用户" << username << "密码验证通过";
+        qInfo() << "✓ 用户" << username << "人脸验证通过 (距离:" << distance << ")";
 
-        // 第三步: 验证人脸
-        QVector<float> descriptor = recognizer.extractDescriptorFromBase64(image);
+        // 认证通过
+        QString token = JwtHelper::generateToken(username);
+        db.updateLastLogin(username);
+
+        response["success"] = true;
+        response["message"] = "认证成功";
+        response["username"] = username;
+        response["token"] = token;
+        response["authMethod"] = "密码+人脸双重认证";
+        response["faceDistance"] = distance;
         
-        if (descriptor.isEmpty()) {
+        qInfo() << "🎉 用户" << username << "登录成功";
+        
+        res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
+                    "application/json"); });
+
+    // ========== API: 连拍登录(多帧,任一帧匹配即通过) ==========
+    svr.Post("/api/face/login-burst", [&](const httplib::Request &req, httplib::Response &res)
+             {
+        qInfo() << "收到连拍登录请求";
+
+        FaceRequest face = parseFaceRequest(req, burstMaxFrames);
+        QString username = face.username;
+        QString password = face.password;
+
+        QJsonObject response;
+
+        if (username.isEmpty() || password.isEmpty() || face.frames.empty()) {
             response["success"] = false;
-            response["message"] = "未检测到人脸,请确保光线充足并正对摄像头";
+            response["message"] = "请提供完整的认证信息(账号+密码+连拍人脸图像)";
             res.status = 400;
             res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
                         "application/json");
             return;
         }
 
-        QVector<float> storedDescriptor = db.getUserDescriptor(username);
-        
+        UserAuthRecord authRecord = db.getAuthRecord(username);
+        if (!verifyUserPassword(authRecord, username, password, res)) {
+            return;
+        }
+
+        const QVector<float> &storedDescriptor = authRecord.descriptor;
         if (storedDescriptor.isEmpty()) {
             response["success"] = false;
             response["message"] = "该账号未录入人脸信息,请联系管理员";
@@ -279,22 +915,44 @@ int main(int argc, char *argv[])
             return;
         }
 
-        double distance = FaceRecognizer::computeDistance(descriptor, storedDescriptor);
-        qInfo() << "与用户" << username << "的人脸距离:" << distance;
-        
-        if (distance >= 0.45) {  // 阈值: dlib 推荐 0.6,这里用 0.45 更严格
-            qWarning() << "✗ 用户" << username << "人脸验证失败 (距离:" << distance << ")";
+        // 第三步: 逐帧验证人脸,任一帧距离低于阈值即停止
+        double bestDistance = 999.0;
+        int matchedFrame = -1;
+        int framesProcessed = 0;
+        FaceError faceError = FaceError::None;
+        {
+            auto recognizer = recognizerPool.acquire();
+            framesProcessed = recognizer->extractDescriptorsFromBurst(
+                face.frames, [&](int frameIndex, const QVector<float> &descriptor) {
+                    double distance = FaceRecognizer::computeMinDistance(descriptor, storedDescriptor);
+                    bestDistance = qMin(bestDistance, distance);
+                    if (distance < FaceRecognizer::MATCH_THRESHOLD) {
+                        matchedFrame = frameIndex;
+                        return true;
+                    }
+                    return false;
+                });
+            faceError = recognizer->lastError();
+        }
+
+        if (matchedFrame < 0 && faceError != FaceError::None) {
+            sendFaceError(res, faceError);
+            return;
+        }
+
+        if (matchedFrame < 0) {
+            qWarning() << "✗ 用户" << username << "连拍人脸验证失败 (最小距离:" << bestDistance << ")";
             response["success"] = false;
-            response["message"] = QString("人脸识别失败,相似度不足 (距离: %1)").arg(distance, 0, 'f', 3);
+            response["message"] = QString("人脸识别失败,相似度不足 (距离: %1)").arg(bestDistance, 0, 'f', 3);
+            response["framesProcessed"] = framesProcessed;
             res.status = 401;
             res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
                         "application/json");
             return;
         }
 
-        qInfo() << "✓ 用户" << username << "人脸验证通过 (距离:" << distance << ")";
+        qInfo() << "✓ 用户" << username << "连拍第" << matchedFrame + 1 << "帧人脸验证通过 (距离:" << bestDistance << ")";
 
-        // 认证通过
         QString token = JwtHelper::generateToken(username);
         db.updateLastLogin(username);
 
@@ -303,13 +961,134 @@ int main(int argc, char *argv[])
         response["username"] = username;
         response["token"] = token;
         response["authMethod"] = "密码+人脸双重认证";
-        response["faceDistance"] = distance;
-        
+        response["faceDistance"] = bestDistance;
+        response["matchedFrame"] = matchedFrame;
+        response["framesProcessed"] = framesProcessed;
+
         qInfo() << "🎉 用户" << username << "登录成功";
-        
+
         res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
                     "application/json"); });
 
+    // ========== API: 1:N 人脸识别(无需用户名) ==========
+    svr.Post("/api/face/identify", [&](const httplib::Request &req, httplib::Response &res)
+             {
+        qInfo() << "收到 1:N 识别请求";
+
+        QString currentUser;
+        if (!verifyDeviceOrToken(req, deviceKeys, currentUser, res)) {
+            return;
+        }
+
+        FaceRequest face = parseFaceRequest(req);
+        int topK = face.topK;
+
+        QJsonObject response;
+
+        if (!face.hasImage()) {
+            response["success"] = false;
+            response["message"] = "人脸图像不能为空";
+            res.status = 400;
+            res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
+                           "application/json");
+            return;
+        }
+
+        FaceError faceError = FaceError::None;
+        QVector<float> descriptor = extractFaceDescriptor(recognizerPool, descriptorCache, face, faceError);
+        if (descriptor.isEmpty()) {
+            sendFaceError(res, faceError);
+            return;
+        }
+
+        QVector<GalleryMatch> matches = gallery.search(descriptor, topK);
+        QJsonArray matchArray;
+        for (const auto &match : matches) {
+            QJsonObject matchObj;
+            matchObj["username"] = match.username;
+            matchObj["distance"] = match.distance;
+            matchObj["matched"] = match.distance < FaceRecognizer::MATCH_THRESHOLD;
+            matchArray.append(matchObj);
+        }
+
+        bool identified = !matches.isEmpty() && matches.first().distance < FaceRecognizer::MATCH_THRESHOLD;
+        response["success"] = true;
+        response["identified"] = identified;
+        response["username"] = identified ? matches.first().username : QString();
+        response["matches"] = matchArray;
+
+        if (identified) {
+            qInfo() << "✓ 识别为用户" << matches.first().username << "(距离:" << matches.first().distance << ", 调用方:" << currentUser << ")";
+        } else {
+            qInfo() << "✗ 人脸库中无匹配用户 (调用方:" << currentUser << ")";
+        }
+
+        res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
+                       "application/json"); });
+
+    // ========== API: 提取图像中所有人脸的特征(合影签到等场景) ==========
+    svr.Post("/api/face/extract-all", [&](const httplib::Request &req, httplib::Response &res)
+             {
+        qInfo() << "收到多人脸提取请求";
+
+        QString currentUser;
+        if (!extractAndVerifyToken(req, currentUser, res)) {
+            return;
+        }
+
+        FaceRequest face = parseFaceRequest(req);
+
+        QJsonObject response;
+
+        if (!face.hasImage()) {
+            response["success"] = false;
+            response["message"] = "人脸图像不能为空";
+            res.status = 400;
+            res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
+                           "application/json");
+            return;
+        }
+
+        QVector<FaceDetection> detections;
+        FaceError faceError = FaceError::None;
+        {
+            auto recognizer = recognizerPool.acquire();
+            detections = face.imageSize > 0
+                ? recognizer->extractAllDescriptorsFromBytes(face.imageData, face.imageSize)
+                : recognizer->extractAllDescriptorsFromBase64(face.base64Image);
+            faceError = recognizer->lastError();
+        }
+        if (detections.isEmpty()) {
+            sendFaceError(res, faceError);
+            return;
+        }
+
+        QJsonArray faceArray;
+        for (const auto &detection : detections) {
+            QJsonObject box;
+            box["x"] = detection.box.x();
+            box["y"] = detection.box.y();
+            box["width"] = detection.box.width();
+            box["height"] = detection.box.height();
+
+            QJsonArray descriptorArray;
+            for (float value : detection.descriptor) {
+                descriptorArray.append(static_cast<double>(value));
+            }
+
+            QJsonObject faceObj;
+            faceObj["box"] = box;
+            faceObj["descriptor"] = descriptorArray;
+            faceArray.append(faceObj);
+        }
+
+        response["success"] = true;
+        response["count"] = faceArray.size();
+        response["faces"] = faceArray;
+
+        res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
+                       "application/json"); });
+
     // ========== 1. 用户管理类 API ==========
 
     // API: 获取当前用户信息
@@ -334,8 +1113,8 @@ int main(int argc, char *argv[])
             response["username"] = userInfo["username"].toString();
             response["created_at"] = userInfo["created_at"].toString();
             response["last_login"] = userInfo["last_login"].toString();
-            response["hasFace"] = !db.getUserDescriptor(username).isEmpty();
-            response["hasPassword"] = !db.getUserPassword(username).isEmpty();
+            response["hasFace"] = userInfo["has_face"].toBool();
+            response["hasPassword"] = userInfo["has_password"].toBool();
         }
 
         res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
@@ -360,8 +1139,8 @@ int main(int argc, char *argv[])
             userObj["username"] = user["username"].toString();
             userObj["created_at"] = user["created_at"].toString();
             userObj["last_login"] = user["last_login"].toString();
-            userObj["hasFace"] = !db.getUserDescriptor(user["username"].toString()).isEmpty();
-            userObj["hasPassword"] = !db.getUserPassword(user["username"].toString()).isEmpty();
+            userObj["hasFace"] = user["has_face"].toBool();
+            userObj["hasPassword"] = user["has_password"].toBool();
             userArray.append(userObj);
         }
 
@@ -498,12 +1277,11 @@ int main(int argc, char *argv[])
             return;
         }
 
-        auto bodyJson = QJsonDocument::fromJson(QByteArray::fromStdString(req.body)).object();
-        QString image = bodyJson["image"].toString();
+        FaceRequest face = parseFaceRequest(req, enrollMaxImages);
 
         QJsonObject response;
 
-        if (image.isEmpty()) {
+        if (!face.hasImage() && face.frames.empty()) {
             response["success"] = false;
             response["message"] = "人脸图像不能为空";
             res.status = 400;
@@ -513,13 +1291,10 @@ int main(int argc, char *argv[])
         }
 
         // 提取人脸特征
-        QVector<float> descriptor = recognizer.extractDescriptorFromBase64(image);
+        FaceError faceError = FaceError::None;
+        QVector<float> descriptor = extractTemplateSet(recognizerPool, descriptorCache, face, enrollMaxImages, faceError);
         if (descriptor.isEmpty()) {
-            response["success"] = false;
-            response["message"] = "未检测到人脸,请确保光线充足并正对摄像头";
-            res.status = 400;
-            res.set_content(QJsonDocument(response).toJson(QJsonDocument::Compact).toStdString(),
-                           "application/json");
+            sendFaceError(res, faceError);
             return;
         }
 
@@ -527,6 +1302,7 @@ int main(int argc, char *argv[])
         if (db.updateUserDescriptor(username, descriptor)) {
             response["success"] = true;
             response["message"] = "人脸信息更新成功";
+            response["faceTemplates"] = FaceRecognizer::templateCount(descriptor);
             qInfo() << "✅ 用户" << username << "更新人脸信息成功";
         } else {
             response["success"] = false;
@@ -540,10 +1316,52 @@ int main(int argc, char *argv[])
     // 在独立线程中启动 HTTP 服务器
     QThread *serverThread = QThread::create([&]()
                                             {
-        qInfo() << "🚀 HTTP 服务器启动在 http://0.0.0.0:3000";
+        qInfo() << "🚀 HTTP 服务器启动在 http://0.0.0.0:3000,启动总用时" << startupTimer.elapsed() << "ms";
         svr.listen("0.0.0.0", 3000); });
     serverThread->start();
 
+    // 监听先启动(/api/health 可用),预热在后台进行,全部副本和微批处理器预热完成后才标记就绪
+    int warmUpRounds = envInt("FACE_WARMUP_ROUNDS", 1);
+    auto warmUpDone = std::async(std::launch::async, [&]() {
+        QElapsedTimer warmUpTimer;
+        warmUpTimer.start();
+        for (int round = 0; round < warmUpRounds; ++round) {
+            recognizerPool.warmUp();
+            if (embeddingBatcher) {
+                embeddingBatcher->warmUp();
+            }
+        }
+        serviceReady = true;
+        qInfo() << "✅ 预热完成,服务就绪,用时" << warmUpTimer.elapsed() << "ms";
+    });
+
+    // 旧格式人脸特征在后台分批改写为原始格式;FACE_BLOB_MIGRATION_BATCH=0 时不改写(读取仍兼容旧格式)
+    std::atomic<bool> stopMigration{false};
+    std::future<void> migrationDone;
+    const int migrationBatch = envInt("FACE_BLOB_MIGRATION_BATCH", 500);
+    if (migrationBatch > 0) {
+        migrationDone = std::async(std::launch::async, [&db, &stopMigration, migrationBatch]() {
+            QElapsedTimer migrationTimer;
+            migrationTimer.start();
+            int migrated = db.migrateLegacyDescriptors(migrationBatch, stopMigration);
+            if (migrated > 0) {
+                qInfo() << "✅ 已将" << migrated << "条旧格式人脸特征改写为原始格式,用时" << migrationTimer.elapsed() << "ms";
+            }
+        });
+    }
+
+    // 收到退出信号后走正常退出流程,保证退出前的清理工作(如保存索引)得以执行
+    std::signal(SIGINT, handleShutdownSignal);
+    std::signal(SIGTERM, handleShutdownSignal);
+    QTimer shutdownTimer;
+    QObject::connect(&shutdownTimer, &QTimer::timeout, [&app]() {
+        if (g_shutdownRequested) {
+            qInfo() << "收到退出信号,正在关闭服务...";
+            app.quit();
+        }
+    });
+    shutdownTimer.start(200);
+
     int ret = app.exec();
 
     svr.stop();
@@ -551,5 +1369,15 @@ int main(int argc, char *argv[])
     serverThread->wait();
     delete serverThread;
 
+    stopMigration = true;
+    if (migrationDone.valid()) {
+        migrationDone.wait();
+    }
+
+    // HTTP 服务已停止,不会再有新的登录,写入缓冲中的最近登录时间
+    db.flushLastLogins();
+
+    gallery.saveIndex(annIndexPath);
+
     return ret;
 }